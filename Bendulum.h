@@ -17,6 +17,13 @@
  *   Each time the magnet passes, beat() returns the number of microseconds that have passed since the magnet passed the
  *   last time. In this way, the bendulum can be used to drive a time-of-day clock display.
  *
+ *   If the bendulum stops, or the coil comes disconnected, beat() waits forever for a pass that never comes. Where
+ *   that matters, use timedBeat(timeout) instead. It does the same thing as beat() but always returns within timeout
+ *   ms, even if the bendulum doesn't pass, and returns a status: BEAT_OK if a beat was measured, BEAT_TIMEOUT if the
+ *   bendulum didn't pass in time, BEAT_REJECTED if the beat was rejected by the outlier filter and BEAT_FIRST for the
+ *   very first pass, from which nothing can be measured. The beat duration is available from getLastBeat(). Since
+ *   a pass has to be followed by a kick, timeout must be more than 55 ms for anything to be detected.
+ *
  *   A Bendulum object has three operational modes. The way the duration of a beat is determined depends on which mode the 
  *   Bendulum object is in:
  *
@@ -24,11 +31,16 @@
  *           ===========   ========================================================================================
  *           SETTLING      The duration returned is measured using the (corrected) Arduino real-time Clock.
  *           SCALING       The duration returned is measured using the (corrected) Arduino real-time Clock.
+ *           TUNING        The duration returned is measured using the (corrected) Arduino real-time Clock.
  *           CALIBRATING   A running average of beat duration is updated using the measured duration of the current 
  *                         beat. As in the SETTLING mode, the current duration is measured with the (corrected) 
  *                         Arduino real-time clock. The updated average is returned.
  *           CALFINISH     The duration returned is the value of the running average. No measurement is done.
- *           RUNNING       The duration returned is the value of the running average. No measurement is done.
+ *           RUNNING       The duration returned is the value of the running average. Measurement continues in the
+ *                         background (see below).
+ *           STARTING      The duration returned is measured as in SETTLING, unless the bendulum was already
+ *                         calibrated, in which case it's the calibrated one, as in RUNNING. Between passes, the coil
+ *                         is pulsed "blind" to get a resting bendulum swinging (see below).
  *
  *   Unless setRunMode() is used to change it, when beat() is first called the Bendulum object is in SETTLING mode. 
  *   It continues in this mode for getTgtSettle() cycles (one cycle = two beats). The purpose of this mode is to let
@@ -42,6 +54,101 @@
  *   calibration is now complete. At that point the Bendulum object switches to RUNNING mode, in which it remains 
  *   indefinitely.
  *
+ *   The sequence of modes can be changed. setNextMode(mode, next) makes next the mode that follows mode once mode has
+ *   run its course, and getNextMode(mode) says which mode that is. For example, setNextMode(SETTLING, CALIBRATING)
+ *   goes straight from SETTLING to CALIBRATING, for a bendulum whose peak scaling is already known and set with
+ *   setPeakScale(). Each mode finishes up when it's over (SETTLING sets the blanking time, TUNING chooses the kick
+ *   delay) and gets ready when it's entered, whether that's through the sequence or through setRunMode(). Only the
+ *   order is table driven, though. When each mode has run its course (a number of cycles, the estimator converging,
+ *   and so on) and what it does on the way in and out are fixed for each mode, and a sketch can't change them; it can
+ *   only cut a mode short, or go to any mode it likes, with setRunMode().
+ *
+ *   If asked to, the Bendulum object spends a while between SCALING and CALIBRATING in TUNING mode, choosing the kick
+ *   delay, the time from detecting a pass to starting the kick. When the kick comes relative to the magnet's passing
+ *   changes the length of the beat, so any variation in its timing shows up as variation in the beat. In TUNING mode,
+ *   the average cycle is measured for getTgtTune() cycles (outliers don't count) at each of TUNESTEPS kick delays,
+ *   TUNESTEP ms apart starting at TUNEMIN ms. A parabola is fitted to the results and the kick delay is set to its
+ *   vertex, where the cycle is least sensitive to the delay, if the vertex is among the delays tried and the
+ *   curvature is clearly more than noise; otherwise it's set to the delay tried where the cycle changed least. TUNING
+ *   is off by default, since it changes both how long startup takes and the kick delay, which is otherwise 5 ms;
+ *   setTgtTune(n), with n up to TUNEMAX, turns it on, and setTgtTune(0) turns it off again. The kick delay can also
+ *   be set by hand with setKickDelay().
+ *
+ *   After each kick, the coil rings for a while and any voltage it shows then is not the bendulum passing, so the
+ *   coil is ignored for a time after the kick. In SETTLING mode, the Bendulum object measures how long the ringing
+ *   goes on after each kick: until the coil has read zero for QUIETTIME ms. It keeps track of the longest ringing
+ *   seen, letting that shrink by 1/RINGDECAY after each kick so that one noisy ring-down isn't held against the
+ *   bendulum for good. Once SETTLING is over, the time the coil is ignored is set to one and a half times that plus
+ *   BLANKMARGIN ms, but between BLANKMIN and BLANKMAX ms. This lets fast bendulums, whose beats are shorter than
+ *   BLANKMAX ms, be used. getBlankTime() returns the time and setBlankTime() sets it by hand; entering SETTLING mode
+ *   measures it afresh.
+ *
+ *   While the coil is being ignored after a kick, the Bendulum object has nothing to do but wait. setIdle(fn) has it
+ *   call fn, over and over, during that time instead (except in SETTLING mode, when it's measuring the ring-down, and
+ *   not within IDLEMARGIN ms of the end). A BendulumCommand object (see BendulumCommand.h), polled from there, lets
+ *   the bias, smoothing interval, peak scaling, beat duration and run mode be changed over a serial line while the
+ *   bendulum runs, with no blocking reads and without disturbing the timing.
+ *
+ *   The biggest remaining error in RUNNING mode is usually temperature: the bendulum's spring and the Arduino's
+ *   ceramic resonator both change with it. setThermometer(fn) gives the Bendulum object a function to read the
+ *   temperature, e.g. from a thermistor on an analog pin, in any units in which the reading is roughly linear in
+ *   temperature. It's read once a beat while the coil is being ignored. In CALIBRATING and RUNNING modes, the
+ *   Bendulum object regresses the cycle durations on the readings over the last TEMPWINDOW cycles to learn how much a
+ *   unit rise in temperature lengthens a cycle, getTempCoef(). It uses the result only once the temperature has
+ *   varied by TEMPSPREAD or more and the correction it gives is good to TEMPERR μs. The live estimate applies at the
+ *   average temperature of the beats it was made from, getTempRef(), and each beat beat() returns is corrected for
+ *   the difference between that and the latest reading. Since the durations are as measured by the Arduino clock, the
+ *   resonator's drift is learned and corrected along with the spring's. setTempCoef() and setTempRef() set both by
+ *   hand, e.g. from a saved calibration.
+ *
+ *   Over weeks, a bendulum's beat also drifts slowly, e.g. as its spring relaxes. In CALIBRATING and RUNNING modes
+ *   the Bendulum object averages the cycle durations and the temperature readings over blocks of DRIFTBLOCK cycles
+ *   and fits a drift model to the block averages, corrected for temperature, weighting each block 1/DRIFTWINDOW less
+ *   than the one after it. The correction is made afresh at each fit with getTempCoef() as it is then, so blocks from
+ *   before the temperature coefficient was learned don't pass the temperature's rise and fall off as drift. The model
+ *   is a straight line or, after setDriftOrder(2), a parabola; setDriftOrder(0) turns it off. A term of the model is
+ *   only used once there are DRIFTMIN blocks for each term and it is at least DRIFTSIGMA standard errors from zero,
+ *   so that noise isn't mistaken for drift. The live estimate applies at the average cycle number of the beats it was
+ *   made from, and each beat beat() returns is corrected for the drift the model forecasts since then. getDriftRate()
+ *   is the change in the duration of a cycle, in μs, per DRIFTBLOCK cycles and getDriftAccel() half the change in
+ *   that per DRIFTBLOCK cycles. Saved along with the beat duration, bias, getTempCoef() and getTempRef(), they are
+ *   set again with setDriftRate() and setDriftAccel() after setBeatDuration(). Entering SETTLING mode starts the
+ *   fitting over, since TUNING may change the kick delay and so the beat.
+ *
+ *   On AVR processors, a BendulumPPS object turns the bendulum's time into a one pulse per second output for other
+ *   equipment to synchronize to. After each beat, pass it the duration beat() returned, the clock time of the pass
+ *   that ended the beat, from getPassTime(), and getBias(). The pulses' edges are made by the compare unit of Timer1,
+ *   which BendulumTimer takes over as a free-running time base, so they don't wait on loop(). Timer1's interrupt
+ *   handlers are defined in the headers rather than linked in with the library, so only a sketch that includes
+ *   BendulumPPS.h gives up Timer1 and can't use Servo and the like. See BendulumPPS.h for the details and for how to
+ *   measure the pulses' jitter.
+ *
+ *   Likewise, a BendulumDisplay object shows the bendulum's time of day on a multiplexed 7-segment LED display. It's
+ *   refreshed from a Timer2 interrupt, not from loop(), and after each beat it's passed the beat's duration and
+ *   getPassTime(). Its interrupt handler is defined in BendulumDisplay.h, so only a sketch that includes that gives
+ *   up Timer2 and tone(). So that neither the LEDs nor the interrupts disturb the coil's readings, setWatch(fn) has
+ *   the Bendulum object call fn(true) when it starts watching the coil and fn(false) when it stops; given
+ *   BendulumDisplay::watch, the display goes dark for that part of each beat. When RUNNING, the watch only starts
+ *   WATCHMARGIN ms before the next pass is due -- the coming beat's average duration after the last pass, by the
+ *   corrected clock, plus getCoastDelta() if the beat is coasting -- so the display is lit for most of each beat. In
+ *   the other modes, when the pass can't be foreseen as well, the watch starts as soon as the coil stops being
+ *   ignored after a kick, and when SETTLING it takes in the ring-down after the kick, too. See BendulumDisplay.h for
+ *   the details.
+ *
+ *   And a BendulumHands object drives the hands of an analog dial with a stepper motor. Its steps, made by Timer1's
+ *   other compare unit, are spread evenly over each hour by whole-number arithmetic and kept in line with the
+ *   bendulum's time, beat by beat. After the time is set, the hands catch up at no more than a set number of steps a
+ *   second. Its interrupt handler is defined in BendulumHands.h, so only a sketch that includes that gets it. See
+ *   BendulumHands.h for the details.
+ *
+ *   Ticks and tocks are beats in opposite directions. The coil only shows the positive half of the pulse the passing
+ *   magnet induces in it. Going one way, that half comes first and rises slowly out of nothing; going the other, it
+ *   comes second and rises steeply from the zero crossing at the middle of the pulse. A beat ending on a pass with
+ *   the slower rise is a tick. The Bendulum object keeps running averages of the rise times of ticks and of tocks and
+ *   counts each pass as whichever its rise time is nearer to. So tickAvg and tockAvg always refer to the same
+ *   direction, whichever way the bendulum was going when it was first seen and even across restarts and missed beats.
+ *   If the rise times aren't clearly different, ticks and tocks simply alternate.
+ *
  *   The net effect is that the Bendulum object automatically characterizes the bendulum or pendulum it is driving,
  *   first by measuring the strength of the pulses it induces in the coil and second by measuring the average duration 
  *   of its beat. Once the measurements are done, the Bendulum object assumes the bendulum or pendulum is isochronous.
@@ -54,11 +161,79 @@
  *   setBias() and incremented/decremented by using incrBias(). Positive bias means the real-time clock's "microseconds" 
  *   are shorter than real microseconds.
  *
+ *   Each measured beat first passes through an outlier filter. A beat whose duration is far from the median of the
+ *   last few beats in the same direction -- more than about four standard deviations, as estimated from their median
+ *   absolute deviation -- or that is more than 5 seconds long is rejected. In SETTLING and SCALING modes a rejected
+ *   beat returns 0; in CALIBRATING mode it is simply left out of the averages. A bump or a slammed door therefore
+ *   doesn't spoil a calibration in progress. getRejects() returns the number of beats rejected since the Bendulum
+ *   object last entered SETTLING or CALIBRATING mode.
+ *
  *   In addition to just instantiating a Bendulum object and letting it go through its modes, it's possible to change the
  *   mode as required using setRunMode(). For example, to recalibrate, simply do a setRunMode(CALIBRATING). The bendulum 
  *   will enter CALIBRATING mode, do a calibration run and then enter CALFINISH for a beat and, finally, settle into 
  *   RUNNING mode.
  *
+ *   Calibration is done on a "shadow" estimate of beat duration that is kept apart from the "live" one beat()
+ *   returns. The shadow estimate also keeps track of its own uncertainty. It replaces the live estimate, all at once,
+ *   only when its uncertainty has become smaller than that of the live one. During the first calibration there is
+ *   nothing better, so this happens every beat. When recalibrating, though, beat() keeps returning the previous
+ *   result until the new one is better, so a recalibration never makes things worse. The shadow estimate also keeps
+ *   being updated in RUNNING mode, as a running average over the last getTgtSmoothing() cycles, and is promoted
+ *   whenever it becomes better than the live estimate. getUncertainty() returns the standard error, in μs, of the
+ *   live estimate. A beat duration set by hand with setBeatDuration() or incrBeatDuration() is never replaced by the
+ *   shadow estimate in RUNNING mode; a subsequent setRunMode(CALIBRATING) replaces it at the end of the calibration
+ *   run.
+ *
+ *   How the shadow estimate is worked out is up to a calibration estimator, chosen when the Bendulum object is
+ *   declared. Bendulum uses RunningMean: running averages of the tick and tock durations, which take the least RAM
+ *   and CPU and finish calibrating after exactly getTgtSmoothing() cycles. BasicBendulum<LeastSquares> fits a
+ *   straight line to the times of successive passes instead. That is less sensitive to errors in detecting passes,
+ *   and it finishes calibrating as soon as its estimate is good to LSQTARGET μs, which can be many fewer cycles, at
+ *   the cost of some floating point arithmetic on each beat. BasicBendulum<RobustMean> is RunningMean with beats that
+ *   are well off the average cut back before they're averaged, so that the odd late pass or draught that isn't bad
+ *   enough to be rejected as an outlier doesn't count for as much. BasicBendulum<KalmanFilter> is a Kalman filter
+ *   that follows the beat as it wanders and, like LeastSquares, finishes calibrating as soon as its estimate is good
+ *   to KALTARGET μs. BendulumEstimators.h describes the estimators and the methods an estimator has. Any class with
+ *   those methods will do: a sketch can declare a BasicBendulum<MyEstimator> with an estimator of its own, without
+ *   changing the library, since the whole of BasicBendulum is in its header (and Bendulum.tpp, which the header
+ *   includes).
+ *
+ *   getTgtSmoothing() can be as long as a million cycles or more, which, over a night or two, averages the beat
+ *   duration down to well under a part per million. Running averages that long need care. RunningMean keeps its
+ *   averages in 64-bit fixed point with a large fraction and rounds each update to the nearest, so a long window
+ *   neither stalls nor drifts one way through rounding. And since a part per million of a beat is less than a μs, the
+ *   live estimate is kept to 1/FINESCALE μs: beat() returns whole μs but carries the fraction over from beat to beat,
+ *   so the beats it returns add up to the estimate.
+ *
+ *   A Bendulum object can also get a bendulum going from rest by itself. In STARTING mode, whenever no pass is seen
+ *   for a while, the coil is given a "blind" kick. The blind kicks are evenly spaced, starting STARTMAX ms apart and,
+ *   every STARTHOLD kicks, coming 1/32 closer together until they are STARTMIN ms apart, after which the sweep starts
+ *   over. When the spacing comes close enough to the bendulum's natural beat, it starts to swing and its passes are
+ *   detected and kicked as usual. Once STARTGOOD cycles in a row have been detected, the Bendulum object switches to
+ *   SETTLING mode, or, if it had already been calibrated, back to RUNNING mode. Use setRunMode(STARTING) to start
+ *   this way. Use setAutoStart(true) to have the Bendulum object switch to STARTING mode by itself whenever STALLTIME
+ *   ms go by with no pass; that way an unattended bendulum that stops gets itself going again. (With self-starting
+ *   enabled, beat() doesn't return until the bendulum is swinging; use timedBeat() if that's not acceptable.)
+ *
+ *   Kicking the bendulum on every beat is more than it needs once it's swinging well, and, on battery power,
+ *   wasteful. In RUNNING mode, the kick can be skipped on some beats. setKickEvery(n) has the bendulum kicked only
+ *   every nth beat, and setKickThreshold(peak) has it kicked in between, too, whenever the peak read from the coil
+ *   during a pass (see getPeak()) falls below peak. A beat that starts without a kick is a little longer than one
+ *   that starts with one. The Bendulum object learns the difference, getCoastDelta(), and allows for it in what
+ *   beat() returns. It also allows for ticks and tocks differing in length, since the skipped kicks may fall mostly
+ *   on one of them. The duration beat() returned for the last beat is available from getLastBeat().
+ *
+ *   On processors that aren't AVRs, where there's CPU time and double precision floating point to spare, a
+ *   BendulumFit object (see BendulumFit.h) can estimate the cycle duration from the coil readings themselves rather
+ *   than from when the passes are detected. It fits the pulse shape, a fundamental and FITHARMONICS - 1 harmonics,
+ *   over windows of FITCYCLES cycles and reports a cycle duration for each window. Attach one with setFit(); it is
+ *   started off with the first cycle the Bendulum object measures (or with the calibrated cycle duration, if there is
+ *   one), so that it has homed in on the bendulum by the time CALIBRATING begins. While CALIBRATING, the Bendulum
+ *   object averages the estimates from FITMIN or more windows and, whenever the average is better than the live
+ *   estimate, makes it the live one. CALIBRATING ends as soon as the average's standard error is below FITTARGET μs,
+ *   which, with a steady bendulum, is long before the usual calibration would have settled. Its available() is true
+ *   whenever a new estimate is ready from getPeriod().
+ *
  *   It is also possible to operate a bendulum whose parameters you *know* and and skip all the automatic calibration
  *   stuff. After instantiating the Bendulum object, put it in RUNNING mode by invoking setRunMode(RUNNING) and then set 
  *   the beat duration with setBeatDuration() and the peak scaling with setPeakScale().
@@ -73,6 +248,8 @@
 #else
   #include <WProgram.h> // Arduino 0022
 #endif
+#include "BendulumFit.h"
+#include "BendulumEstimators.h"
 
 // Run mode constants
 #define SETTLING	(0)
@@ -80,41 +257,206 @@
 #define CALIBRATING	(2)
 #define CALFINISH   (3)
 #define RUNNING		(4)
+#define STARTING	(5)
+#define TUNING		(6)
+#define MODES		(7)							// Number of run modes
+
+// Self-starting constants
+#define STARTMAX	(1500)						// Longest beat duration (ms) tried when self-starting
+#define STARTMIN	(400)						// Shortest beat duration (ms) tried when self-starting
+#define STARTHOLD	(8)							// Number of blind kicks given at each beat duration tried
+#define STARTGOOD	(4)							// Cycles in a row that must be detected for the bendulum to be started
+#define STALLTIME	(5000)						// Time (ms) without a pass after which the bendulum has stopped
+
+// Kick delay tuning constants
+#define TUNEMIN		(1)							// Shortest kick delay (ms) tried when TUNING
+#define TUNESTEP	(2)							// Difference (ms) between successive kick delays tried when TUNING
+#define TUNESTEPS	(5)							// Number of kick delays tried when TUNING
+#define TUNEMAX		(1000)						// Most cycles each kick delay can be measured for when TUNING
+#define TUNESIGMA	(3)							// Min number of standard errors the fitted curvature must be from zero
+												//   for its vertex to be used
+
+// Post-kick blanking constants
+#define BLANKMIN	(20)						// Shortest time (ms) to ignore the coil after a kick
+#define BLANKMAX	(250)						// Longest time (ms) to ignore the coil after a kick
+#define QUIETTIME	(10)						// Time (ms) the coil must read zero for its ring-down to be over
+#define BLANKMARGIN	(10)						// Time (ms) added to the ring-down seen when SETTLING to get the blanking time
+#define RINGDECAY	(8)							// The longest ring-down seen shrinks by 1/RINGDECAY after each kick
+#define IDLEMARGIN	(5)							// Time (ms) before the end of the blanking time after which idle isn't called
+
+// Watch constants
+#define WATCHMARGIN	(100)						// Time (ms) before the next pass is due that the coil is watched from
+												//   when RUNNING
+
+// Direction constants
+#define RISEWINDOW	(8)							// Number of passes the typical rise times of ticks and tocks average over
+
+// Temperature compensation constants
+#define TEMPWINDOW	(16384)						// Number of cycles over which the temperature coefficient is learned
+#define TEMPSPREAD	(10)						// Min standard deviation of the temperature readings before the
+												//   temperature coefficient is learned from them
+#define TEMPERR		(1)							// Max standard error (μs) of the correction for a typical change in
+												//   temperature before the temperature coefficient is used
 
-class Bendulum {
+// Drift model constants
+#define DRIFTBLOCK	(4096)						// Number of cycles averaged into each point the drift model is fitted to
+#define DRIFTWINDOW	(64)						// Number of blocks over which the drift model is fitted
+#define DRIFTMIN	(4)							// Min number of blocks per coefficient before the drift model is fitted
+#define DRIFTSIGMA	(3)							// Min number of standard errors a drift coefficient must be from zero
+												//   to be used
+
+// Beat status constants returned by timedBeat()
+#define BEAT_OK		(0)							// A beat was measured
+#define BEAT_TIMEOUT	(1)						// No pass over the coil before the timeout
+#define BEAT_REJECTED	(2)						// A beat was measured but rejected (by the outlier filter or as > 5 s)
+#define BEAT_FIRST	(3)							// The first pass; there's no previous one to measure from
+
+// Outlier filter constants
+#define FILTERSIZE	(7)						// Number of recent ticks (and tocks) the outlier filter looks at
+
+template <class Estimator = RunningMean>
+class BasicBendulum {
 private:
 // Instance variables
 	byte sensePin;							// Pin on which we sense the bendulum's passing
 	byte kickPin;							// Pin on which we kick the bendulum as it passes
-	int cycleCounter;						// Current cycle counter for SETTLING and SCALING modes
+	int cycleCounter;						// Current cycle counter for SETTLING, SCALING and TUNING modes
 	int tgtSettle;							// Number of cycles to run in SETTLING mode
 	int tgtScale;							// Number of cycles to run in SCALING mode
-	int tgtSmoothing;						// Target smoothing interval in cycles
-	int curSmoothing;						// Current smoothing interval in cycles
-	long uspb;								// Current best estimate of the duration of a beat in μs
+	int tgtTune;							// Number of cycles to measure each kick delay for in TUNING mode
+	int32_t tgtSmoothing;					// Target smoothing interval in cycles
+	int32_t uspb;							// Current best estimate of the duration of a beat in μs
+	int uspbFrac;							// Fraction of a μs, in 1/FINESCALEths, by which the estimate exceeds uspb
+	int fracSum;							// Fractions of a μs carried over from the beats returned so far
 	int bias;								// Arduino clock correction in tenths of a second per day
 	int peakScale;							// Peak scaling value (adjusted during calibration)
 	boolean tick;							// Whether currently awaiting a tick or a tock
-	long tickAvg;							// Average duration of ticks (μs)
-	long tockAvg;							// Average duration of tocks (μs)
-	long tickPeriod;						// Duration of last tick (μs)
-	long tockPeriod;						// Duration of last tock (μs)
-	unsigned long lastTime;					// Clock time (μs) last time through beat()
-	unsigned long timeBeforeLast;			// Clock time (μs) time before last time through beat()
+	int32_t tickAvg;						// Average duration of ticks (μs)
+	int32_t tockAvg;						// Average duration of tocks (μs)
+	int32_t tickPeriod;						// Duration of last tick (μs)
+	int32_t tockPeriod;						// Duration of last tock (μs)
+	uint32_t lastTime;						// Clock time (μs) last time through beat()
+	uint32_t timeBeforeLast;				// Clock time (μs) time before last time through beat()
+	uint32_t kickEnd;						// Clock time (μs) at the end of the last kick (or skipped kick)
+	uint32_t lastNoise;						// Clock time (μs) the coil last read non-zero after the last kick
+	int blankTime;							// Time (ms) to ignore the coil after a kick
+	int ringTime;							// Longest ring-down (ms) seen after a kick while SETTLING, decaying
 	byte runMode;							// Run mode -- SETTLING, CALIBRATING or RUNNING
+	boolean autoStart;						// Whether to switch to STARTING automatically if the bendulum stops
+	int startPeriod;						// Beat duration (ms) currently being tried when STARTING
+	byte startCount;						// Number of blind kicks given at startPeriod so far
+	byte kickEvery;							// When RUNNING, kick at least every kickEvery beats
+	int kickThreshold;						// When RUNNING, also kick whenever the peak is below this
+	byte sinceKick;							// Number of beats since the last kick
+	boolean skipped;						// Whether the kick was skipped at the last pass
+	boolean coasted;						// Whether the kick was skipped at the start of the last beat
+	int32_t coastDelta;						// Average extra duration (μs) of a beat that started without a kick
+	long long coastFine;					// coastDelta with AVGSHIFT fraction bits
+	int32_t coastCount;						// Number of beats that went into coastDelta (up to tgtSmoothing)
+	int peak;								// Peak value read from the coil during the last pass
+	uint32_t lastRise;						// Time (μs) the coil took to rise to its peak during the last pass
+	uint32_t tickRise;						// Typical rise time (μs) of ticks and of tocks; 0 until they're
+	uint32_t tockRise;						//   told apart
+#ifndef __AVR__
+	BendulumFit *fit;						// Spectral period estimator to pass coil readings to, if any
+	int32_t fitSeen;						// Number of its windows already looked at
+	int fitN;								// Number of its estimates averaged while CALIBRATING (-1: none yet)
+	double fitBase;							// The first of them, corrected for the Arduino clock (μs)
+	float fitLast;							// The last of them, less fitBase (μs)
+	float fitSum, fitSum2, fitSumLag;		// Sums of them less fitBase, their squares and the products of
+											//   successive ones
+	float fitTemp;							// Sum of the temperatures read as each of them was finished
+	boolean fitLive;						// Whether the live estimate is their average
+#endif
+	int kickDelay;							// Time (ms) from detecting a pass to starting the kick
+	byte nextMode[MODES];					// The mode each mode is followed by when it has run its course
+	void (*idle)();							// Function to call while the coil is being ignored, if any
+	int (*thermometer)();					// Function that reads the temperature, if any
+	void (*watch)(boolean watching);		// Function to tell when the coil is being watched, if any
+	int temp;								// Latest temperature reading
+	boolean tempDue;						// Whether the temperature is still to be read during this beat
+	float tempCoef;							// Change in the duration of a cycle (μs) per unit rise in temperature
+	float tempRef;							// Temperature at which the live estimate of beat duration applies
+	int32_t tempBase;						// Cycle duration (μs) the temperature regression is made relative to
+	float tempMean;							// Running mean of the temperature
+	float cycMean;							// Running mean of the cycle duration less tempBase (μs)
+	float cycVar;							// Running variance of the cycle duration (μs²)
+	float tempVar;							// Running variance of the temperature
+	float tempCov;							// Running covariance of the temperature and the cycle duration
+	int32_t tempN;							// Number of cycles in the running means (at most TEMPWINDOW)
+	byte tuneStep;							// Which of the TUNESTEPS kick delays is being measured when TUNING
+	int32_t tuneBase;						// Cycle duration (μs) the sums below are made relative to; 0 if none yet
+	int32_t tuneSum[TUNESTEPS];				// Sum of the durations (μs) of the cycles measured at each kick delay
+	float tuneSum2[TUNESTEPS];				//   and of their squares, both less tuneBase
+	int tuneN[TUNESTEPS];					// Number of cycles measured at each kick delay
+	int32_t beatDur;						// Duration (μs) of the last beat, as returned by beat()
+	int32_t tickHist[FILTERSIZE];			// Durations of the most recent ticks (μs), raw, for the outlier filter
+	int32_t tockHist[FILTERSIZE];			// Durations of the most recent tocks (μs), raw, for the outlier filter
+	byte tickNext, tockNext;				// Index in tickHist and in tockHist of the next slot to fill
+	byte tickCount, tockCount;				// Number of slots in tickHist and in tockHist that have been filled
+	unsigned int rejects;					// Number of beats rejected as outliers since (re)starting or calibrating
+	Estimator shadow;						// Shadow estimate of the average durations of ticks and tocks
+	long long tempFine;						// Average temperature over the cycles in the shadow estimate, with
+											//   AVGSHIFT fraction bits
+	int32_t cycleNo;						// Number of the current cycle, counting from 1
+	byte driftOrder;						// Order of the drift model: 0 (none), 1 (linear) or 2 (quadratic)
+	float driftRate;						// Change in the duration of a cycle (μs) per DRIFTBLOCK cycles, at driftRef
+	float driftAccel;						// Half the change in driftRate per DRIFTBLOCK cycles
+	float driftRef;							// Cycle number at which the live estimate of beat duration applies
+	int32_t blockStart;						// Cycle number at which the current block started
+	int32_t blockSum;						// Sum of the cycle durations in the current block less driftBase (μs)
+	int blockN;								// Number of cycles in blockSum
+	int32_t driftBase;						// Cycle duration (μs) the drift model is made relative to; 0 if none yet
+	int32_t blockTemp;						// Sum of the temperature readings in the current block, less
+											//   driftTempBase
+	int driftTempBase;						// Temperature the drift model's temperatures are made relative to
+	float driftS[5];						// Weighted sums of the powers of the blocks' ages (in blocks)
+	float driftY[3];						// Weighted sums of the blocks' mean cycle durations times their ages' powers
+	float driftYY;							// Weighted sum of the squares of the blocks' mean cycle durations
+	float driftT[3];						// Weighted sums of the blocks' mean temperatures times their ages' powers
+	float driftYT, driftTT;					// Weighted sums of the blocks' mean cycle durations times their mean
+											//   temperatures and of the squares of their mean temperatures
+	long long ageFine;						// Average cycle number of the cycles in the shadow estimate, with
+											//   AVGSHIFT fraction bits
+	float liveVar;							// Variance (μs²) of the cycle duration implied by tickAvg and tockAvg;
+											//   < 0 if unknown, 0 if set by hand
+// Internal methods
+	boolean isOutlier(int32_t period);		// Record a beat's duration and say whether it's an outlier
+	int32_t medianOf(int32_t *values, byte n);
+											// Sort values[0..n-1] in place and return the median
+	void promote();							// Make the shadow estimate the live one
+	void kick(int wait, int length);		// Kick the bendulum: wait ms, then pulse the coil for length ms
+	byte giveUp(int kickTime);				// Handle timedBeat() giving up waiting for the bendulum
+	void chooseKickDelay();					// Choose the kick delay from the measurements made while TUNING
+	boolean modeDone(boolean outlier);		// Say whether the current mode has run its course
+	void advance();							// Leave the current mode for the one that follows it
+	void learnTemp(int32_t cycle);			// Learn the temperature coefficient from a cycle's duration (μs)
+	int32_t tempAdjust();					// Get the correction (μs) to a beat's duration for the temperature
+	void resetDrift();						// Forget the blocks the drift model is fitted to
+	void learnDrift(int32_t cycle);			// Add a cycle's duration (μs) to the current block of the drift model
+	void closeBlock();						// Finish the current block and refit the drift model
+	void fitDrift();						// Fit the drift model to the blocks
+	int32_t driftAdjust();					// Get the correction (μs) to a beat's duration for drift
+	boolean fitDone();						// True if the spectral estimator's estimate is good enough to be done
+#ifndef __AVR__
+	void useFit();							// Start the spectral estimator off and use its estimates
+#endif
 
 public:
 // Constructors
-	Bendulum(byte sensePin = A2, byte kickPin = 12);  // Bendulum on specified sense and kick pins
+	BasicBendulum(byte sensePin = A2, byte kickPin = 12);  // Bendulum on specified sense and kick pins
 // Operational methods
-	long beat();							// Do one beat (half a cycle) return  length of a beat in μs
-	long cycle();							// Do one cycle (two beats) return length of a beat in μs
+	int32_t beat();							// Do one beat (half a cycle) return  length of a beat in μs
+	byte timedBeat(uint32_t timeout);		// Do one beat giving up after timeout ms; return BEAT_OK, BEAT_TIMEOUT, etc.
+	int32_t cycle();						// Do one cycle (two beats) return length of a beat in μs
 // Getters and setters
-	int getCycleCounter();					// Get the number of cycles in the current mode (except RUNNING)
+	int32_t getCycleCounter();				// Get the number of cycles in the current mode (except RUNNING)
 	int getTgtSettle();						// Get number of cycles to run in SETTLING mode
 	void setTgtSettle(int interval);		// Set number of cycles to run in SETTLING mode
-	int getTgtSmoothing();					// Get target smoothing interval in cycles
-	void setTgtSmoothing(int interval);		// Set target smoothing interval in cycles
+	int getTgtTune();						// Get number of cycles to measure each kick delay for in TUNING mode
+	void setTgtTune(int interval);			// Set number of cycles to measure each kick delay for in TUNING mode
+	int32_t getTgtSmoothing();				// Get target smoothing interval in cycles
+	void setTgtSmoothing(int32_t interval);	// Set target smoothing interval in cycles
 	int getBias();							// Get Arduino clock correction in tenths of a second per day
 	void setBias(int factor);				// Set Arduino clock correction in tenths of a second per day
 	int incrBias(int factor);				// Increment Arduino clock correction by factor tenths of a second per day
@@ -124,11 +466,51 @@ public:
 	float getAvgBpm();						// Get the average beats per minute
 	float getCurBpm();						// Get the current beats per minute
 	float getDelta();						// Get the current ratio of tick length to tock length
-	long getBeatDuration();					// Get the beat duration in μs
-	void setBeatDuration(long beatDur);		// Set the beat duration in μs
-	long incrBeatDuration(long incr);		// Increment beat duration so that clock runs faster by incr seconds per day
+	int32_t getBeatDuration();				// Get the beat duration in μs
+	void setBeatDuration(int32_t beatDur);	// Set the beat duration in μs
+	int32_t incrBeatDuration(int32_t incr);	// Increment beat duration so that clock runs faster by incr seconds per day
+	unsigned int getRejects();				// Get the number of beats rejected as outliers
+	int32_t getLastBeat();					// Get the duration in μs of the last beat, as returned by beat()
+	uint32_t getPassTime();					// Get the clock time (μs) of the last pass
+	byte getKickEvery();					// Get the maximum number of beats between kicks when RUNNING
+	void setKickEvery(byte beats);			// Set the maximum number of beats between kicks when RUNNING
+	int getKickThreshold();					// Get the peak below which a RUNNING bendulum is always kicked
+	void setKickThreshold(int threshold);	// Set the peak below which a RUNNING bendulum is always kicked
+	int getPeak();							// Get the peak value read from the coil during the last pass
+	int getKickDelay();						// Get the time in ms from detecting a pass to starting the kick
+	void setKickDelay(int delayTime);		// Set the time in ms from detecting a pass to starting the kick
+	int getBlankTime();						// Get the time in ms the coil is ignored after a kick
+	void setBlankTime(int ms);				// Set the time in ms the coil is ignored after a kick
+	void setIdle(void (*idleFn)());			// Set the function to call while the coil is being ignored
+	void setThermometer(int (*thermFn)());	// Set the function that reads the temperature
+	void setWatch(void (*watchFn)(boolean watching));
+											// Set the function to tell when the coil is being watched
+	int getTemperature();					// Get the latest temperature reading
+	float getTempCoef();					// Get the change in cycle duration (μs) per unit rise in temperature
+	void setTempCoef(float coef);			// Set the change in cycle duration (μs) per unit rise in temperature
+	float getTempRef();						// Get the temperature at which the beat duration estimate applies
+	void setTempRef(float ref);				// Set the temperature at which the beat duration estimate applies
+	byte getDriftOrder();					// Get the order of the drift model: 0 (none), 1 (linear) or 2 (quadratic)
+	void setDriftOrder(byte order);			// Set the order of the drift model: 0 (none), 1 (linear) or 2 (quadratic)
+	float getDriftRate();					// Get the change in cycle duration (μs) per DRIFTBLOCK cycles
+	void setDriftRate(float rate);			// Set the change in cycle duration (μs) per DRIFTBLOCK cycles
+	float getDriftAccel();					// Get half the change in drift rate per DRIFTBLOCK cycles
+	void setDriftAccel(float accel);		// Set half the change in drift rate per DRIFTBLOCK cycles
+#ifndef __AVR__
+	void setFit(BendulumFit *estimator);	// Pass coil readings to estimator (NULL for none)
+#endif
+	int32_t getCoastDelta();				// Get how much longer (μs) a beat is if the kick starting it is skipped
+	float getUncertainty();					// Get the standard error of the beat duration in μs (< 0 if unknown)
+	boolean getAutoStart();					// Get whether the bendulum is restarted automatically if it stops
+	void setAutoStart(boolean enable);		// Set whether the bendulum is restarted automatically if it stops
 	int getRunMode();						// Get the current run mode -- SETTLING, CALIBRATING or RUNNING
 	void setRunMode(byte mode);				// Set the run mode
+	byte getNextMode(byte mode);			// Get the mode that follows mode
+	void setNextMode(byte mode, byte next);	// Set the mode that follows mode
 };
 
+typedef BasicBendulum<RunningMean> Bendulum;	// The usual Bendulum, which calibrates with running averages
+
+#include "Bendulum.tpp"						// The member functions
+
 #endif
\ No newline at end of file
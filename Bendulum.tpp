@@ -0,0 +1,1638 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   Bendulum.tpp Copyright 2013 by D. L. Ehnebuske 
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US) 
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics. 
+ *
+ *   A "bendulum" is a long, slender, springy piece of metal, held vertically, whose lower end is fixed and whose upper 
+ *   end has a weight that is free to move back and forth -- a sort of upside-down pendulum. A bendulum terminates in a 
+ *   magnet that moves across a many-turn coil of fine wire positioned at the center of its swing. The motion of the magnet 
+ *   is detected as it passes over the coil by the current the magnet induces. Just after the magnet passes, a pulse of 
+ *   current through the coil induces a magnetic field in it. The field gives the magnet a small push, keeping the bendulum 
+ *   going. A Bendulum object works just as well for a pendulum whose bob has a magnet at its end.
+ *
+ *   The main method is beat(). This method is intended to be invoked repeatedly in the loop() function of an Arduino sketch.
+ *   Each time the magnet passes, beat() returns the number of microseconds that have passed since the magnet passed the
+ *   last time. In this way, the bendulum can be used to drive a time-of-day clock display.
+ *
+ *   If the bendulum stops, or the coil comes disconnected, beat() waits forever for a pass that never comes. Where
+ *   that matters, use timedBeat(timeout) instead. It does the same thing as beat() but always returns within timeout
+ *   ms, even if the bendulum doesn't pass, and returns a status: BEAT_OK if a beat was measured, BEAT_TIMEOUT if the
+ *   bendulum didn't pass in time, BEAT_REJECTED if the beat was rejected by the outlier filter and BEAT_FIRST for the
+ *   very first pass, from which nothing can be measured. The beat duration is available from getLastBeat(). Since
+ *   a pass has to be followed by a kick, timeout must be more than 55 ms for anything to be detected.
+ *
+ *   A Bendulum object has three operational modes. The way the duration of a beat is determined depends on which mode the 
+ *   Bendulum object is in:
+ *
+ *           Mode          Beat duration determined by
+ *           ===========   ========================================================================================
+ *           SETTLING      The duration returned is measured using the (corrected) Arduino real-time Clock.
+ *           SCALING       The duration returned is measured using the (corrected) Arduino real-time Clock.
+ *           TUNING        The duration returned is measured using the (corrected) Arduino real-time Clock.
+ *           CALIBRATING   A running average of beat duration is updated using the measured duration of the current 
+ *                         beat. As in the SETTLING mode, the current duration is measured with the (corrected) 
+ *                         Arduino real-time clock. The updated average is returned.
+ *           CALFINISH     The duration returned is the value of the running average. No measurement is done.
+ *           RUNNING       The duration returned is the value of the running average. Measurement continues in the
+ *                         background (see below).
+ *           STARTING      The duration returned is measured as in SETTLING, unless the bendulum was already
+ *                         calibrated, in which case it's the calibrated one, as in RUNNING. Between passes, the coil
+ *                         is pulsed "blind" to get a resting bendulum swinging (see below).
+ *
+ *   Unless setRunMode() is used to change it, when beat() is first called the Bendulum object is in SETTLING mode. 
+ *   It continues in this mode for getTgtSettle() cycles (one cycle = two beats). The purpose of this mode is to let
+ *   the bendulum or pendulum settle into a regular motion since its motion is typically disturbed at startup from 
+ *   having been given a start-up push by hand. Once it completes SETTLING the Bendulum object switches to SCALING mode 
+ *   for getTgtScale() cycles. During SCALING mode, the peak voltage induced in the coil by the passing magnet is 
+ *   determined and saved in peakScale. With SCALING over, the Bendulum object moves to CALIBRATING mode, in which it 
+ *   remains for getTgtSmoothing() additional cycles. During CALIBRATING mode, the average duration of tick and tock 
+ *   beats is measured and saved in tickAvg, tockAvg and their average -- uspb. At the end of CALIBRATING the Bendulum 
+ *   object switches to CALFINISH mode for one beat. The CALFINISH mode serves as notice to the using sketch that 
+ *   calibration is now complete. At that point the Bendulum object switches to RUNNING mode, in which it remains 
+ *   indefinitely.
+ *
+ *   The sequence of modes can be changed. setNextMode(mode, next) makes next the mode that follows mode once mode has
+ *   run its course, and getNextMode(mode) says which mode that is. For example, setNextMode(SETTLING, CALIBRATING)
+ *   goes straight from SETTLING to CALIBRATING, for a bendulum whose peak scaling is already known and set with
+ *   setPeakScale(). Each mode finishes up when it's over (SETTLING sets the blanking time, TUNING chooses the kick
+ *   delay) and gets ready when it's entered, whether that's through the sequence or through setRunMode(). Only the
+ *   order is table driven, though. When each mode has run its course (a number of cycles, the estimator converging,
+ *   and so on) and what it does on the way in and out are fixed for each mode, and a sketch can't change them; it can
+ *   only cut a mode short, or go to any mode it likes, with setRunMode().
+ *
+ *   If asked to, the Bendulum object spends a while between SCALING and CALIBRATING in TUNING mode, choosing the kick
+ *   delay, the time from detecting a pass to starting the kick. When the kick comes relative to the magnet's passing
+ *   changes the length of the beat, so any variation in its timing shows up as variation in the beat. In TUNING mode,
+ *   the average cycle is measured for getTgtTune() cycles (outliers don't count) at each of TUNESTEPS kick delays,
+ *   TUNESTEP ms apart starting at TUNEMIN ms. A parabola is fitted to the results and the kick delay is set to its
+ *   vertex, where the cycle is least sensitive to the delay, if the vertex is among the delays tried and the
+ *   curvature is clearly more than noise; otherwise it's set to the delay tried where the cycle changed least. TUNING
+ *   is off by default, since it changes both how long startup takes and the kick delay, which is otherwise 5 ms;
+ *   setTgtTune(n), with n up to TUNEMAX, turns it on, and setTgtTune(0) turns it off again. The kick delay can also
+ *   be set by hand with setKickDelay().
+ *
+ *   After each kick, the coil rings for a while and any voltage it shows then is not the bendulum passing, so the
+ *   coil is ignored for a time after the kick. In SETTLING mode, the Bendulum object measures how long the ringing
+ *   goes on after each kick: until the coil has read zero for QUIETTIME ms. It keeps track of the longest ringing
+ *   seen, letting that shrink by 1/RINGDECAY after each kick so that one noisy ring-down isn't held against the
+ *   bendulum for good. Once SETTLING is over, the time the coil is ignored is set to one and a half times that plus
+ *   BLANKMARGIN ms, but between BLANKMIN and BLANKMAX ms. This lets fast bendulums, whose beats are shorter than
+ *   BLANKMAX ms, be used. getBlankTime() returns the time and setBlankTime() sets it by hand; entering SETTLING mode
+ *   measures it afresh.
+ *
+ *   While the coil is being ignored after a kick, the Bendulum object has nothing to do but wait. setIdle(fn) has it
+ *   call fn, over and over, during that time instead (except in SETTLING mode, when it's measuring the ring-down, and
+ *   not within IDLEMARGIN ms of the end). A BendulumCommand object (see BendulumCommand.h), polled from there, lets
+ *   the bias, smoothing interval, peak scaling, beat duration and run mode be changed over a serial line while the
+ *   bendulum runs, with no blocking reads and without disturbing the timing.
+ *
+ *   The biggest remaining error in RUNNING mode is usually temperature: the bendulum's spring and the Arduino's
+ *   ceramic resonator both change with it. setThermometer(fn) gives the Bendulum object a function to read the
+ *   temperature, e.g. from a thermistor on an analog pin, in any units in which the reading is roughly linear in
+ *   temperature. It's read once a beat while the coil is being ignored. In CALIBRATING and RUNNING modes, the
+ *   Bendulum object regresses the cycle durations on the readings over the last TEMPWINDOW cycles to learn how much a
+ *   unit rise in temperature lengthens a cycle, getTempCoef(). It uses the result only once the temperature has
+ *   varied by TEMPSPREAD or more and the correction it gives is good to TEMPERR μs. The live estimate applies at the
+ *   average temperature of the beats it was made from, getTempRef(), and each beat beat() returns is corrected for
+ *   the difference between that and the latest reading. Since the durations are as measured by the Arduino clock, the
+ *   resonator's drift is learned and corrected along with the spring's. setTempCoef() and setTempRef() set both by
+ *   hand, e.g. from a saved calibration.
+ *
+ *   Over weeks, a bendulum's beat also drifts slowly, e.g. as its spring relaxes. In CALIBRATING and RUNNING modes
+ *   the Bendulum object averages the cycle durations and the temperature readings over blocks of DRIFTBLOCK cycles
+ *   and fits a drift model to the block averages, corrected for temperature, weighting each block 1/DRIFTWINDOW less
+ *   than the one after it. The correction is made afresh at each fit with getTempCoef() as it is then, so blocks from
+ *   before the temperature coefficient was learned don't pass the temperature's rise and fall off as drift. The model
+ *   is a straight line or, after setDriftOrder(2), a parabola; setDriftOrder(0) turns it off. A term of the model is
+ *   only used once there are DRIFTMIN blocks for each term and it is at least DRIFTSIGMA standard errors from zero,
+ *   so that noise isn't mistaken for drift. The live estimate applies at the average cycle number of the beats it was
+ *   made from, and each beat beat() returns is corrected for the drift the model forecasts since then. getDriftRate()
+ *   is the change in the duration of a cycle, in μs, per DRIFTBLOCK cycles and getDriftAccel() half the change in
+ *   that per DRIFTBLOCK cycles. Saved along with the beat duration, bias, getTempCoef() and getTempRef(), they are
+ *   set again with setDriftRate() and setDriftAccel() after setBeatDuration(). Entering SETTLING mode starts the
+ *   fitting over, since TUNING may change the kick delay and so the beat.
+ *
+ *   On AVR processors, a BendulumPPS object turns the bendulum's time into a one pulse per second output for other
+ *   equipment to synchronize to. After each beat, pass it the duration beat() returned, the clock time of the pass
+ *   that ended the beat, from getPassTime(), and getBias(). The pulses' edges are made by the compare unit of Timer1,
+ *   which BendulumTimer takes over as a free-running time base, so they don't wait on loop(). Timer1's interrupt
+ *   handlers are defined in the headers rather than linked in with the library, so only a sketch that includes
+ *   BendulumPPS.h gives up Timer1 and can't use Servo and the like. See BendulumPPS.h for the details and for how to
+ *   measure the pulses' jitter.
+ *
+ *   Likewise, a BendulumDisplay object shows the bendulum's time of day on a multiplexed 7-segment LED display. It's
+ *   refreshed from a Timer2 interrupt, not from loop(), and after each beat it's passed the beat's duration and
+ *   getPassTime(). Its interrupt handler is defined in BendulumDisplay.h, so only a sketch that includes that gives
+ *   up Timer2 and tone(). So that neither the LEDs nor the interrupts disturb the coil's readings, setWatch(fn) has
+ *   the Bendulum object call fn(true) when it starts watching the coil and fn(false) when it stops; given
+ *   BendulumDisplay::watch, the display goes dark for that part of each beat. When RUNNING, the watch only starts
+ *   WATCHMARGIN ms before the next pass is due -- the coming beat's average duration after the last pass, by the
+ *   corrected clock, plus getCoastDelta() if the beat is coasting -- so the display is lit for most of each beat. In
+ *   the other modes, when the pass can't be foreseen as well, the watch starts as soon as the coil stops being
+ *   ignored after a kick, and when SETTLING it takes in the ring-down after the kick, too. See BendulumDisplay.h for
+ *   the details.
+ *
+ *   And a BendulumHands object drives the hands of an analog dial with a stepper motor. Its steps, made by Timer1's
+ *   other compare unit, are spread evenly over each hour by whole-number arithmetic and kept in line with the
+ *   bendulum's time, beat by beat. After the time is set, the hands catch up at no more than a set number of steps a
+ *   second. Its interrupt handler is defined in BendulumHands.h, so only a sketch that includes that gets it. See
+ *   BendulumHands.h for the details.
+ *
+ *   Ticks and tocks are beats in opposite directions. The coil only shows the positive half of the pulse the passing
+ *   magnet induces in it. Going one way, that half comes first and rises slowly out of nothing; going the other, it
+ *   comes second and rises steeply from the zero crossing at the middle of the pulse. A beat ending on a pass with
+ *   the slower rise is a tick. The Bendulum object keeps running averages of the rise times of ticks and of tocks and
+ *   counts each pass as whichever its rise time is nearer to. So tickAvg and tockAvg always refer to the same
+ *   direction, whichever way the bendulum was going when it was first seen and even across restarts and missed beats.
+ *   If the rise times aren't clearly different, ticks and tocks simply alternate.
+ *
+ *   The net effect is that the Bendulum object automatically characterizes the bendulum or pendulum it is driving,
+ *   first by measuring the strength of the pulses it induces in the coil and second by measuring the average duration 
+ *   of its beat. Once the measurements are done, the Bendulum object assumes the bendulum or pendulum is isochronous.
+ *
+ *   This would work nearly perfectly except that the real-time clock in most Arduinos is stable but not too accurate 
+ *   (it's a ceramic resonator, not a crystal). That is, real-time clock ticks are essentially equal to one another in 
+ *   duration but their durations are not exactly the number of microseconds they should be. To correct for this, we use 
+ *   a correction factor, getBias(). The value of getBias() is the number of tenths of a second per day by which the 
+ *   real-time clock in the Arduino must be compensated in order for it to be accurate. This number may be set using 
+ *   setBias() and incremented/decremented by using incrBias(). Positive bias means the real-time clock's "microseconds" 
+ *   are shorter than real microseconds.
+ *
+ *   Each measured beat first passes through an outlier filter. A beat whose duration is far from the median of the
+ *   last few beats in the same direction -- more than about four standard deviations, as estimated from their median
+ *   absolute deviation -- or that is more than 5 seconds long is rejected. In SETTLING and SCALING modes a rejected
+ *   beat returns 0; in CALIBRATING mode it is simply left out of the averages. A bump or a slammed door therefore
+ *   doesn't spoil a calibration in progress. getRejects() returns the number of beats rejected since the Bendulum
+ *   object last entered SETTLING or CALIBRATING mode.
+ *
+ *   In addition to just instantiating a Bendulum object and letting it go through its modes, it's possible to change the
+ *   mode as required using setRunMode(). For example, to recalibrate, simply do a setRunMode(CALIBRATING). The bendulum 
+ *   will enter CALIBRATING mode, do a calibration run and then enter CALFINISH for a beat and, finally, settle into 
+ *   RUNNING mode.
+ *
+ *   Calibration is done on a "shadow" estimate of beat duration that is kept apart from the "live" one beat()
+ *   returns. The shadow estimate also keeps track of its own uncertainty. It replaces the live estimate, all at once,
+ *   only when its uncertainty has become smaller than that of the live one. During the first calibration there is
+ *   nothing better, so this happens every beat. When recalibrating, though, beat() keeps returning the previous
+ *   result until the new one is better, so a recalibration never makes things worse. The shadow estimate also keeps
+ *   being updated in RUNNING mode, as a running average over the last getTgtSmoothing() cycles, and is promoted
+ *   whenever it becomes better than the live estimate. getUncertainty() returns the standard error, in μs, of the
+ *   live estimate. A beat duration set by hand with setBeatDuration() or incrBeatDuration() is never replaced by the
+ *   shadow estimate in RUNNING mode; a subsequent setRunMode(CALIBRATING) replaces it at the end of the calibration
+ *   run.
+ *
+ *   How the shadow estimate is worked out is up to a calibration estimator, chosen when the Bendulum object is
+ *   declared. Bendulum uses RunningMean: running averages of the tick and tock durations, which take the least RAM
+ *   and CPU and finish calibrating after exactly getTgtSmoothing() cycles. BasicBendulum<LeastSquares> fits a
+ *   straight line to the times of successive passes instead. That is less sensitive to errors in detecting passes,
+ *   and it finishes calibrating as soon as its estimate is good to LSQTARGET μs, which can be many fewer cycles, at
+ *   the cost of some floating point arithmetic on each beat. BasicBendulum<RobustMean> is RunningMean with beats that
+ *   are well off the average cut back before they're averaged, so that the odd late pass or draught that isn't bad
+ *   enough to be rejected as an outlier doesn't count for as much. BasicBendulum<KalmanFilter> is a Kalman filter
+ *   that follows the beat as it wanders and, like LeastSquares, finishes calibrating as soon as its estimate is good
+ *   to KALTARGET μs. BendulumEstimators.h describes the estimators and the methods an estimator has. Any class with
+ *   those methods will do: a sketch can declare a BasicBendulum<MyEstimator> with an estimator of its own, without
+ *   changing the library, since the whole of BasicBendulum is in its header (and Bendulum.tpp, which the header
+ *   includes).
+ *
+ *   getTgtSmoothing() can be as long as a million cycles or more, which, over a night or two, averages the beat
+ *   duration down to well under a part per million. Running averages that long need care. RunningMean keeps its
+ *   averages in 64-bit fixed point with a large fraction and rounds each update to the nearest, so a long window
+ *   neither stalls nor drifts one way through rounding. And since a part per million of a beat is less than a μs, the
+ *   live estimate is kept to 1/FINESCALE μs: beat() returns whole μs but carries the fraction over from beat to beat,
+ *   so the beats it returns add up to the estimate.
+ *
+ *   A Bendulum object can also get a bendulum going from rest by itself. In STARTING mode, whenever no pass is seen
+ *   for a while, the coil is given a "blind" kick. The blind kicks are evenly spaced, starting STARTMAX ms apart and,
+ *   every STARTHOLD kicks, coming 1/32 closer together until they are STARTMIN ms apart, after which the sweep starts
+ *   over. When the spacing comes close enough to the bendulum's natural beat, it starts to swing and its passes are
+ *   detected and kicked as usual. Once STARTGOOD cycles in a row have been detected, the Bendulum object switches to
+ *   SETTLING mode, or, if it had already been calibrated, back to RUNNING mode. Use setRunMode(STARTING) to start
+ *   this way. Use setAutoStart(true) to have the Bendulum object switch to STARTING mode by itself whenever STALLTIME
+ *   ms go by with no pass; that way an unattended bendulum that stops gets itself going again. (With self-starting
+ *   enabled, beat() doesn't return until the bendulum is swinging; use timedBeat() if that's not acceptable.)
+ *
+ *   Kicking the bendulum on every beat is more than it needs once it's swinging well, and, on battery power,
+ *   wasteful. In RUNNING mode, the kick can be skipped on some beats. setKickEvery(n) has the bendulum kicked only
+ *   every nth beat, and setKickThreshold(peak) has it kicked in between, too, whenever the peak read from the coil
+ *   during a pass (see getPeak()) falls below peak. A beat that starts without a kick is a little longer than one
+ *   that starts with one. The Bendulum object learns the difference, getCoastDelta(), and allows for it in what
+ *   beat() returns. It also allows for ticks and tocks differing in length, since the skipped kicks may fall mostly
+ *   on one of them. The duration beat() returned for the last beat is available from getLastBeat().
+ *
+ *   On processors that aren't AVRs, where there's CPU time and double precision floating point to spare, a
+ *   BendulumFit object (see BendulumFit.h) can estimate the cycle duration from the coil readings themselves rather
+ *   than from when the passes are detected. It fits the pulse shape, a fundamental and FITHARMONICS - 1 harmonics,
+ *   over windows of FITCYCLES cycles and reports a cycle duration for each window. Attach one with setFit(); it is
+ *   started off with the first cycle the Bendulum object measures (or with the calibrated cycle duration, if there is
+ *   one), so that it has homed in on the bendulum by the time CALIBRATING begins. While CALIBRATING, the Bendulum
+ *   object averages the estimates from FITMIN or more windows and, whenever the average is better than the live
+ *   estimate, makes it the live one. CALIBRATING ends as soon as the average's standard error is below FITTARGET μs,
+ *   which, with a steady bendulum, is long before the usual calibration would have settled. Its available() is true
+ *   whenever a new estimate is ready from getPeriod().
+ *
+ *   It is also possible to operate a bendulum whose parameters you *know* and and skip all the automatic calibration
+ *   stuff. After instantiating the Bendulum object, put it in RUNNING mode by invoking setRunMode(RUNNING) and then set 
+ *   the beat duration with setBeatDuration() and the peak scaling with setPeakScale().
+ *
+ ****/
+ 
+// Class Bendulum
+//
+// The member functions of the BasicBendulum class template. Bendulum.h includes this file at its end, since they have
+// to be seen wherever the template is used, so that a Bendulum can be built with any estimator that has the methods
+// described in BendulumEstimators.h.
+
+/*
+ *
+ * Constructors
+ *
+ */
+// Bendulum on specified sense and kick pins
+template <class Estimator>
+BasicBendulum<Estimator>::BasicBendulum(byte sPin, byte kPin){
+	sensePin = sPin;						// Pin on which we sense the bendulum's passing
+	kickPin = kPin;							// Pin on which we kick the bendulum as it passes
+
+	analogReference(EXTERNAL);				// We have an external reference, a 47k+47k voltage divider between 
+											//   3.3V and ground
+	pinMode(sensePin, INPUT);				// Set sense pin to INPUT since we read from it
+	pinMode(kickPin, INPUT);				// Put the kick pin in INPUT (high impedance) mode so that the
+											//   induced current doesn't flow to ground
+
+	cycleCounter = 1;						// Current cycle counter for SETTLING, SCALING and TUNING modes
+	tgtSettle = 32;							// Number of cycles to run in SETTLING mode
+	tgtScale = 128;							// Number of cycles to run in SCALING mode
+	tgtTune = 0;							// Number of cycles to measure each kick delay for in TUNING mode;
+											//   none, so there's no TUNING unless asked for
+	tgtSmoothing = 2048;					// Target smoothing interval in cycles
+	bias = 0;								// Arduino clock correction in tenths of a second per day
+	peakScale = 10;							// Peak scaling value (adjusted during calibration)
+	tick = true;							// Whether currently awaiting a tick or a tock
+	tickAvg = 0;							// Average period of ticks (μs)
+	tockAvg = 0;							// Average period of tocks (μs)
+	tickPeriod = 0;							// Length of last tick period (μs)
+	tockPeriod = 0;							// Length of last tock period (μs)
+	timeBeforeLast = lastTime = 0;			// Clock time (μs) last time through beat() (and time before that)
+	kickEnd = lastNoise = 0;				// Clock time (μs) at the end of the last kick
+	blankTime = BLANKMAX;					// Ignore the coil for as long as we might need to after a kick
+	ringTime = 0;							//   until its ring-down has been measured
+	runMode = SETTLING;						// Run mode -- SETTLING, SCALING, CALIBRATING, CALFINISH, RUNNING or STARTING
+	autoStart = false;						// Don't restart automatically; we expect a push by hand
+	startPeriod = STARTMAX;					// Beat duration (ms) to try first when STARTING
+	startCount = 0;
+	tickNext = tockNext = 0;				// Outlier filter history is empty
+	tickCount = tockCount = 0;
+	rejects = 0;							// No beats rejected yet
+	uspb = 0;								// No beat duration yet
+	uspbFrac = 0;
+	fracSum = 0;
+	liveVar = -1;							// Uncertainty of tickAvg and tockAvg is unknown
+	kickEvery = 1;							// Kick on every beat
+	kickThreshold = 0;
+	sinceKick = 0;
+	skipped = coasted = false;
+	coastDelta = 0;							// Nothing known about beats without kicks yet
+	coastFine = 0;
+	coastCount = 1;
+	tempFine = ageFine = 0;					// No cycles in the shadow estimate yet
+	peak = 0;
+	lastRise = 0;
+	tickRise = tockRise = 0;				// Rise times of ticks and tocks unknown
+	beatDur = 0;
+#ifndef __AVR__
+	fit = NULL;								// No spectral estimator
+	fitSeen = 0;
+	fitN = -1;
+	fitBase = 0;
+	fitLast = fitSum = fitSum2 = fitSumLag = fitTemp = 0;
+	fitLive = false;
+#endif
+	kickDelay = 5;							// Time (ms) from detecting a pass to starting the kick
+	idle = NULL;							// No idle function
+	thermometer = NULL;						// No thermometer
+	watch = NULL;							// No watch function
+	temp = tempRef = 0;
+	tempDue = false;
+	tempCoef = 0;							// Nothing known about the effect of temperature yet
+	tempN = 0;
+	cycleNo = 1;
+	driftOrder = 1;							// Fit a linear drift model
+	driftRate = driftAccel = 0;				// Nothing known about drift yet
+	driftRef = 1;
+	resetDrift();
+	nextMode[SETTLING] = SCALING;			// The usual sequence of modes
+	nextMode[SCALING] = TUNING;
+	nextMode[TUNING] = CALIBRATING;
+	nextMode[CALIBRATING] = CALFINISH;
+	nextMode[CALFINISH] = RUNNING;
+	nextMode[RUNNING] = RUNNING;
+	nextMode[STARTING] = SETTLING;
+	tuneStep = 0;
+}
+
+/*
+ *
+ * Operational methods
+ *
+ */
+
+// Do one beat return length of a beat in μs
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::beat(){
+	byte status;
+	
+	do {										// Do the beat with no timeout. (It can still time out while
+		status = timedBeat(0);					//   STARTING, when a blind kick is due; just carry on then)
+	} while (status == BEAT_TIMEOUT);
+	if (status == BEAT_FIRST) {
+		return 0;								// Return 0 on the first beat -- no interval between beats yet!
+	}
+	return beatDur;								// Return microseconds per beat
+}
+
+// Do one beat, but give up if the bendulum hasn't passed within timeout ms (0 means wait forever). The time spent 
+// is never more than timeout ms since, if the bendulum passes, there is always time left to finish kicking it. Return 
+// BEAT_OK, BEAT_TIMEOUT, BEAT_REJECTED or BEAT_FIRST. The beat duration is available through getLastBeat().
+template <class Estimator>
+byte BasicBendulum<Estimator>::timedBeat(uint32_t timeout){
+	const int kickTime = 50;					// Duration in ms of the kick pulse
+	
+	const int maxPeak = 1;						// Scale the peaks (using peakScale) so they're no bigger than this
+	
+	int currCoil = 0;							// The value read from coilPin. The value read here, in volts, is 1024/AREF,
+												//   where AREF is the voltage on that pin. AREF is set by a 1:1 voltage
+												//   divider between the 3.3V pin and Gnd, so 1.65V. Más o menos. The exact 
+												//   value doesn't really matter since we're looking for a spike above noise.
+	int pastCoil = 0;							// The previous value of currCoil
+	int rawCoil;								// The value read from coilPin, unscaled
+	uint32_t topTime = 0;						// Clock time (μs) at entry to loop()
+	uint32_t startTime = micros();				// Clock time (μs) at which we started
+	uint32_t riseStart;							// Clock time (μs) the coil last read zero before the pass
+	uint32_t peakTime = 0;						// Clock time (μs) the coil read its peak during the pass
+	uint32_t rise;								// Time (μs) the coil took to rise from zero to its peak
+	uint32_t watchTime = 0xFFFFFFFFUL;			// Time (μs) we may spend looking for the bendulum; forever unless limited
+	uint32_t limit;								// Some other limit on watchTime (μs)
+	int32_t period;								// Measured, corrected duration of this beat (μs)
+	int32_t diff;								// Amount (μs) by which this direction's beats are longer than the other's
+	int frac;									// Fraction of a μs, in 1/FINESCALEths, to add to this beat's duration
+	boolean outlier;							// Whether this beat was rejected by the outlier filter
+	int32_t cycles;								// Number of cycles in the shadow estimate before this beat
+	int32_t n;									// Number of them the averages that go with it are over
+	int32_t watchFrom;							// Time (μs) after the last pass from which the coil is watched
+	int32_t dev;								// Duration (μs) of a cycle measured when TUNING, less tuneBase
+	
+	if (timeout != 0) {							// Leave enough of the timeout to kick the bendulum if it passes
+		watchTime = timeout > (uint32_t)(kickDelay + kickTime) ? (timeout - kickDelay - kickTime) * 1000 : 0;
+	}
+	if (runMode == STARTING || autoStart) {		// When starting, also stop looking when a blind kick is due. When
+												//   self-starting is enabled, also stop once the bendulum seems stopped
+		limit = (runMode == STARTING ? startPeriod - kickTime : STALLTIME) * 1000UL;
+		limit = limit > startTime - kickEnd ? limit - (startTime - kickEnd) : 0;
+		if (limit < watchTime) {
+			watchTime = limit;
+		}
+	}
+	
+	// watch for passing bendulum
+	tempDue = thermometer != NULL;
+	if (runMode == SETTLING && watch != NULL) {	// When settling, the coil is watched while it rings down, too,
+		watch(true);							//   since how long that takes is what's being measured. There's no
+	}											//   telling when the bendulum will pass yet, either, so the watch
+												//   lasts the whole beat; settling is soon over
+	while (micros() - kickEnd < blankTime * 1000UL) {
+												// Wait for things to calm down after the last kick
+		if (runMode == SETTLING) {				// When settling, measure how long that takes: the coil rings
+			if (analogRead(sensePin) > 0) {		//   down until it has read zero for QUIETTIME ms. Stop waiting
+				lastNoise = micros();			//   then, but not before BLANKMIN ms
+			} else if (micros() - lastNoise >= QUIETTIME * 1000UL && micros() - kickEnd >= BLANKMIN * 1000UL) {
+				break;
+			}
+		} else if (micros() - kickEnd + IDLEMARGIN * 1000UL < blankTime * 1000UL) {
+			if (tempDue) {						// Otherwise, the time is free. Read the temperature, once a beat,
+				temp = thermometer();			//   if there's a thermometer, and then call the sketch's idle
+				tempDue = false;				//   function, if it has one, as long as there's enough time left
+			} else if (idle != NULL) {
+				idle();
+			}
+		}
+		if (micros() - startTime >= watchTime) {
+			return giveUp(kickTime);
+		}
+	}
+	if (runMode == SETTLING) {					// Remember the longest ring-down seen while settling, but let it
+		ringTime -= ringTime / RINGDECAY;		//   decay so one noisy ring-down doesn't count for good
+		if ((int32_t)((lastNoise - kickEnd) / 1000) + 1 > ringTime) {
+			ringTime = (lastNoise - kickEnd) / 1000 + 1;
+		}
+	}
+	if (runMode == RUNNING && tockAvg != 0) {	// When running, the next pass is due the coming beat's duration
+		watchFrom = (tick ? tickAvg : tockAvg) + (skipped ? coastDelta : 0);
+												//   after the last one, the more if the beat is coasting. That's by
+		watchFrom -= (long long)bias * watchFrom / (864000L + bias) + WATCHMARGIN * 1000L;
+												//   the corrected clock; by the Arduino's, the coil needn't be
+	} else {									//   watched until WATCHMARGIN ms before then. Otherwise, it's
+		watchFrom = 0;							//   watched from now on
+	}
+	if (watch != NULL && watchFrom <= 0 && runMode != SETTLING) {
+		watch(true);							// From when the watch starts until the bendulum passes, the coil
+	}											//   is being watched. When SETTLING, it already is
+	do {										// Wait for the voltage to fall to zero
+		currCoil = analogRead(sensePin);
+#ifndef __AVR__
+		if (fit != NULL) {						//   Pass the readings on to the spectral estimator, if any. Below
+			fit->addSample(micros(), currCoil < peakScale ? 0 : currCoil);
+		}										//     peakScale they're noise as far as it's concerned, too
+#endif
+		if (micros() - startTime >= watchTime) {
+			return giveUp(kickTime);
+		}
+	} while (currCoil > 0);
+	peak = 0;
+	riseStart = micros();
+	if (watchFrom > 0) {						// If the watch hasn't started, wait for it, but stop waiting if the
+		while (micros() - lastTime < (uint32_t)watchFrom) {
+			rawCoil = analogRead(sensePin);		//   bendulum comes early
+#ifndef __AVR__
+			if (fit != NULL) {
+				fit->addSample(micros(), rawCoil < peakScale ? 0 : rawCoil);
+			}
+#endif
+			if (rawCoil == 0) {					//   Below peakScale, it's noise, as it is to the rise detection,
+				riseStart = micros();			//     but the rise starts from the last zero all the same
+			} else if (rawCoil >= peakScale) {
+				break;
+			}
+			if (micros() - startTime >= watchTime) {
+				return giveUp(kickTime);
+			}
+		}
+		if (watch != NULL) {
+			watch(true);
+		}
+	}
+	while (currCoil >= pastCoil) {				// While the bendulum hasn't passed over coil,
+		pastCoil = currCoil;					//   loop waiting for the voltage induced in the coil to begin to fall
+		rawCoil = analogRead(sensePin);
+#ifndef __AVR__
+		if (fit != NULL) {
+			fit->addSample(micros(), rawCoil < peakScale ? 0 : rawCoil);
+		}
+#endif
+		if (rawCoil == 0) {						//   Remember when the coil last read zero and when it read its peak
+			riseStart = micros();				//   after that, for the kick policy and to tell which way the
+			peak = 0;							//   bendulum is going
+		} else if (rawCoil > peak) {
+			peak = rawCoil;
+			peakTime = micros();
+		}
+		currCoil = rawCoil / peakScale;
+		if (micros() - startTime >= watchTime) {
+			return giveUp(kickTime);
+		}
+	}
+	
+	topTime= micros();							// Remember when bendulum went by
+	if (watch != NULL) {
+		watch(false);
+	}
+	
+	rise = peakTime > riseStart ? peakTime - riseStart : 0;
+												// The coil only shows the positive lobe of the pulse induced by the
+												//   passing magnet. Going one way, that lobe comes first and rises
+												//   slowly from nothing; going the other way, it comes second and
+												//   rises steeply from the zero crossing. A beat ending on a slow
+												//   rise is a tick
+	if (tickRise > tockRise + tockRise / 2) {	// Once the typical rise times of ticks and tocks are clearly
+												//   different, a beat is whichever its rise is nearer to, so a
+												//   missed pass doesn't throw the two out of step
+		tick = rise + rise > tickRise + tockRise;
+	} else if (lastRise != 0 && rise > lastRise + lastRise / 2) {
+		tick = true;							// Until then, compare the rise with the last pass's, which sets the
+		tickRise = rise;						//   typical ones. A zero rise (the first pass's last one, say) is
+		tockRise = lastRise;					//   no use for that: anything looks clearly different from it
+	} else if (rise != 0 && lastRise > rise + rise / 2) {
+		tick = false;
+		tickRise = lastRise;
+		tockRise = rise;
+	}											// If it's not clear-cut, ticks and tocks alternate
+	if (tickRise > tockRise + tockRise / 2) {	// Keep the typical rise time for this beat's direction up to date
+		if (tick) {
+			tickRise += (int32_t)(rise - tickRise) / RISEWINDOW;
+		} else {
+			tockRise += (int32_t)(rise - tockRise) / RISEWINDOW;
+		}
+	}
+	lastRise = rise;
+	
+	coasted = skipped;							// The beat just finished coasted if the last kick was skipped
+	skipped = runMode == RUNNING && sinceKick + 1 < kickEvery && peak >= kickThreshold;
+	if (skipped) {								// When running, skip the kick if it's not been kickEvery beats
+		sinceKick++;							//   and the bendulum's swinging strongly enough. There's still the
+		kickEnd = lastNoise = micros();			//   pass itself to settle down after, though
+	} else {
+		kick(kickDelay, kickTime);				// Otherwise kick the bendulum to keep it going
+		sinceKick = 0;
+	}
+
+	// Determine the length of time between beats in μs
+	if (lastTime == 0) {						// if first time through
+		lastTime = topTime;						//   Remember when we last saw the bendulum
+		return BEAT_FIRST;						//   No interval between beats yet!
+	}
+	period = topTime - lastTime;				// Measure the beat and apply the (rounded) Arduino clock correction
+	period += ((long long)bias * period + 432000) / 864000;
+												//   in 64 bits, since bias times a period overflows 32 bits once
+												//   |bias| is over about 3500
+	if (coasted) {								// If the beat coasted, it's not like the kicked ones the estimates
+		period -= coastDelta;					//   are made from. Allow for how much longer it is
+	}
+	outlier = period > 5000000 || isOutlier(period);
+												// A beat that's more than 5 seconds long or way off recent ones
+	if (outlier) {								//   can't be real. Count it; the modes ignore it. (One that's too
+												//   long doesn't even go into the outlier filter's history)
+		rejects++;
+	} else if (coasted && runMode == RUNNING && tockAvg != 0) {
+												// Learn how much longer a coasted beat is, from the ones that pass
+		period += coastDelta;					//   the filter, and allow for that instead
+		RunningMean::update(coastFine, period - tempAdjust() - driftAdjust() - (tick ? tickAvg : tockAvg), coastCount);
+		coastDelta = (coastFine + (1LL << (AVGSHIFT - 1))) >> AVGSHIFT;
+		if (coastCount < tgtSmoothing) {
+			coastCount++;
+		}
+		period -= coastDelta;
+	}
+	switch (runMode) {
+		case SCALING:							// When scaling
+			if (pastCoil > maxPeak) {			//  If the peak was more than maxPeak, increase the 
+				peakScale += 1;					//   scaling factor by one. We want 1 <= peaks < 2
+			}									//   Otherwise, it's the same as settling
+			// fall through
+		case SETTLING:							// When settling, scaling, tuning or starting
+		case TUNING:
+		case STARTING:
+			if (runMode == STARTING && outlier) {
+				cycleCounter = 1;				//   The bendulum's not swinging regularly yet if this beat's an outlier
+			}
+			if (runMode == STARTING && liveVar >= 0) {
+				break;							//   A calibrated bendulum keeps its live estimate while it restarts
+			}
+			uspb = outlier ? 0 : period;		//   Otherwise, microseconds per beat is whatever we measured for
+			uspbFrac = 0;						//     this beat
+			if (tick) {							//   If tick
+				tickPeriod = uspb;				//     Remember tickPeriod
+			} else {							//   Else (tock)
+				tockPeriod = uspb;				//     Remember tockPeriod
+			}
+			if (runMode != TUNING || tick) {
+				break;
+			}									//   When tuning, the first cycle at each kick delay started with the
+			if (cycleCounter > 1 && tickPeriod != 0 && tockPeriod != 0) {
+				if (tuneBase == 0) {			//     old one, so only count the ones after that. The sums are
+					tuneBase = tickPeriod + tockPeriod;
+				}								//     kept relative to the first cycle counted, so they fit in 32
+				dev = tickPeriod + tockPeriod - tuneBase;
+				tuneSum[tuneStep] += dev;		//     bits
+				tuneSum2[tuneStep] += (float)dev * dev;
+				tuneN[tuneStep]++;
+			}									//   Once tgtTune cycles have been counted at this kick delay, move
+			cycleCounter++;						//     on to the next one. Outliers, like the beats just after the
+			if (tuneN[tuneStep] >= tgtTune || cycleCounter > 2 * tgtTune + 1) {
+				cycleCounter = 1;				//     delay changes, don't count, so allow up to tgtTune more
+												//     cycles for them
+				if (++tuneStep < TUNESTEPS) {
+					kickDelay = TUNEMIN + tuneStep * TUNESTEP;
+				}
+			}
+			break;
+		case CALIBRATING:						// When calibrating
+		case RUNNING:							// or running, update the shadow estimate
+			if (outlier) {						//   An outlier doesn't go into the averages at all, but the
+				shadow.skip();					//     estimator may need to know there's a gap
+				if (tick) {						//   A rejected tick leaves the next tock without a cycle
+					tickPeriod = 0;
+				}
+				break;
+			}
+			if (!tick && shadow.getTickAvg() == 0) {
+				break;							//   Nor does a tock before the first tick; the calculations start
+			}									//     on a tick
+			if (tick) {							//   Remember the tick or tock period
+				tickPeriod = period;
+			} else {
+				tockPeriod = period;
+				if (tickPeriod != 0) {			//   Learn how the cycle it ends depends on temperature and
+					learnTemp(tickPeriod + period);	//     add it to the drift model
+					learnDrift(tickPeriod + period);
+				}
+			}									//   and add it to the shadow estimate
+			cycles = shadow.getCycles();
+			shadow.add(tick, period, tgtSmoothing);
+			if (shadow.getCycles() != cycles) {	//   If that ended a cycle (or started the estimate afresh), add
+												//     the temperature and cycle number to their averages, over
+												//     as many cycles as the estimate is
+				n = shadow.getCycles() < tgtSmoothing ? shadow.getCycles() : tgtSmoothing;
+				if (thermometer != NULL) {
+					RunningMean::update(tempFine, temp, n);
+				}
+				RunningMean::update(ageFine, cycleNo, n);
+			}
+			if (liveVar < 0 ||					//   If the live estimate is of unknown quality or is worse
+					(!tick && shadow.getVar() >= 0 && shadow.getVar() < liveVar)) {
+				promote();						//     than the shadow, replace it with the shadow
+			}
+			break;
+	}
+#ifndef __AVR__
+	if (fit != NULL) {							// Start the spectral estimator, if any, off and use its estimates
+		useFit();
+	}
+#endif
+	if (modeDone(outlier)) {					// If the current mode has run its course, move on to the next
+		advance();
+	}
+	beatDur = uspb;								// The beat's duration is the current estimate, with the fraction of a
+	frac = uspbFrac;							//   μs it leaves out carried from beat to beat, so that the beats add
+												//   up to the estimate in the long run
+	if (kickEvery > 1 && runMode == RUNNING && tockAvg != 0) {
+												// When skipping kicks, allow for ticks and tocks differing, since the
+												//   skips may fall mostly on one of them, and for whether the beat
+												//   coasted. Half of an odd difference goes into the fraction
+		diff = tick ? tickAvg - tockAvg : tockAvg - tickAvg;
+		beatDur += diff / 2 + (coasted ? coastDelta : 0);
+		frac += diff % 2 * (FINESCALE / 2);
+	}
+	fracSum += frac;
+	while (fracSum >= FINESCALE) {
+		beatDur++;
+		fracSum -= FINESCALE;
+	}
+	while (fracSum < 0) {
+		beatDur--;
+		fracSum += FINESCALE;
+	}
+	if (runMode == CALIBRATING || runMode == CALFINISH || runMode == RUNNING) {
+												// The estimate is for tempRef and driftRef; allow for the actual
+												//   temperature and for the drift since
+		beatDur += tempAdjust() + driftAdjust();
+	}
+	if (!tick) {								// Count the cycle and, if that finishes a block of the drift model,
+		cycleNo++;								//   finish it (or them, if nothing was measured for a while)
+		while (cycleNo - blockStart >= DRIFTBLOCK) {
+			closeBlock();
+		}
+	}
+	tick = !tick;								// Switch whether a tick or a tock
+	timeBeforeLast = lastTime;					// Update timeBeforeLast
+	lastTime = topTime;							// Update lastTime
+	return outlier ? BEAT_REJECTED : BEAT_OK;
+}
+
+// Record the duration of a beat in the outlier filter's history and say whether it's an outlier. This is a Hampel
+// filter: the beat is an outlier if it's further from the median of the recent beats in the same direction than 
+// about four standard deviations, estimated robustly from their median absolute deviation (MAD). The raw duration 
+// goes into the history either way so that, if the bendulum's rate really does change, the filter follows it. Each
+// direction has its own history, filled as beats are labeled ticks or tocks, which needn't alternate strictly.
+template <class Estimator>
+boolean BasicBendulum<Estimator>::isOutlier(int32_t period) {
+	const int32_t minLimit = 500;				// Never reject within this many μs (about 4 analogRead()s) of the median
+	const int minRatio = 1024;					//   nor within 1/minRatio of it
+	
+	int32_t *hist = tick ? tickHist : tockHist;	// The history for this beat's direction
+	int32_t sorted[FILTERSIZE];					// Scratch space for finding medians
+	int32_t median;								// Median of the recent beats
+	int32_t limit;								// How far from the median a beat may be and still be accepted
+	byte *next = tick ? &tickNext : &tockNext;	// Its next slot to fill
+	byte *count = tick ? &tickCount : &tockCount;
+												// Number of its slots filled
+	byte n = *count;							// Number of recent beats available
+	boolean answer = false;						// Assume not an outlier
+	
+	if (n >= 3) {								// If there's enough history to say anything
+		for (byte i = 0; i < n; i++) {			//   Find the median of the history
+			sorted[i] = hist[i];
+		}
+		median = medianOf(sorted, n);
+		for (byte i = 0; i < n; i++) {			//   Find the MAD
+			sorted[i] = abs(hist[i] - median);
+		}
+		limit = medianOf(sorted, n) * 6;		//   4σ is about 6 MADs
+		if (limit < minLimit) {
+			limit = minLimit;
+		}
+		if (limit < median / minRatio) {
+			limit = median / minRatio;
+		}
+		answer = abs(period - median) > limit;
+	}
+	hist[*next] = period;						// Remember this beat, replacing the oldest one
+	if (++*next >= FILTERSIZE) {
+		*next = 0;
+	}
+	if (*count < FILTERSIZE) {
+		(*count)++;
+	}
+	return answer;
+}
+
+// Sort the first n entries of values (n is small) and return the middle one
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::medianOf(int32_t *values, byte n) {
+	for (byte i = 1; i < n; i++) {				// Insertion sort
+		int32_t v = values[i];
+		byte j = i;
+		while (j > 0 && values[j - 1] > v) {
+			values[j] = values[j - 1];
+			j--;
+		}
+		values[j] = v;
+	}
+	return values[n / 2];
+}
+
+// Kick the bendulum: wait for wait ms and then pulse the coil for length ms
+template <class Estimator>
+void BasicBendulum<Estimator>::kick(int wait, int length) {
+	pinMode(kickPin, OUTPUT);					// Prepare kick pin for output
+	delay(wait);								// Wait desired time before pin turn-on
+	digitalWrite(kickPin, HIGH);				// Turn kick pin on
+	delay(length);								// Wait for duration of pulse
+	digitalWrite(kickPin, LOW);					// Turn it off
+	pinMode(kickPin, INPUT);					// Put kick pin in high impedance mode
+	kickEnd = lastNoise = micros();				// Remember when the kick ended
+}
+
+// Called when timedBeat() gives up waiting for the bendulum to pass. When STARTING and a blind kick is due, give it. 
+// The blind kicks come startPeriod ms apart. After STARTHOLD of them, startPeriod is shortened by 1/32, sweeping down 
+// from STARTMAX to STARTMIN over and over until the kicks hit the bendulum's resonance and it starts to swing. When 
+// not STARTING but self-starting is enabled, switch to STARTING if there's been no pass for STALLTIME ms.
+template <class Estimator>
+byte BasicBendulum<Estimator>::giveUp(int kickTime) {
+	if (watch != NULL) {						// Not watching any more
+		watch(false);
+	}
+	if (runMode == STARTING) {
+		cycleCounter = 1;						// Passes no longer in a row
+		if (micros() - kickEnd >= (startPeriod - kickTime) * 1000UL) {
+			kick(0, kickTime);					// Blind kick
+			if (++startCount >= STARTHOLD) {	// Move on to the next beat duration if it's time
+				startCount = 0;
+				startPeriod -= startPeriod / 32;
+				if (startPeriod < STARTMIN) {
+					startPeriod = STARTMAX;
+				}
+			}
+		}
+	} else if (autoStart && micros() - kickEnd >= STALLTIME * 1000UL) {
+		setRunMode(STARTING);
+	}
+	return BEAT_TIMEOUT;
+}
+
+// Choose the kick delay from the measurements made while TUNING. The kick's timing relative to the magnet's passing 
+// changes the duration of the beat, so any jitter in the timing shows up as jitter in the beat. The best kick delay is 
+// the one where the beat duration is least sensitive to it. To find it, fit a parabola to the average cycle durations 
+// measured at each kick delay (by least squares, using polynomials in x that are orthogonal over the kick delays tried)
+// and choose the delay closest to the parabola's vertex, where the slope is zero, whether that's a peak or a trough.
+// The vertex is only used if it's within the delays tried and the parabola's curvature is at least TUNESIGMA standard
+// errors from zero, the standard error coming from how much the cycles measured at each delay varied. Otherwise, as
+// when there's no curvature to speak of, choose the delay tried where the measured cycle duration changed least
+// between its neighbours instead. If the measurements are incomplete, use the middle kick delay.
+template <class Estimator>
+void BasicBendulum<Estimator>::chooseKickDelay() {
+	const float center = (TUNESTEPS - 1) / 2.0;	// Index of the middle kick delay
+	
+	float x;									// Kick delay index, centered, so the sum of x over the delays is 0
+	float q;									// x² less its mean over the delays, so the sums of q and qx are 0
+	float mean;									// Average cycle duration (μs) at a kick delay, less tuneBase
+	float m;									// The same, less that at the first
+	float sxx = 0, sqq = 0, sxm = 0, sqm = 0;	// Sums for the least-squares fit
+	float meanX2 = 0;							// Mean of x² over the delays
+	float ss = 0;								// Sum of the squared deviations of the cycles from their delays' means
+	int32_t dof = 0;							// Degrees of freedom in ss
+	float sqn = 0;								// Sum of q² / number of cycles, for the variance of a
+	float a, b;									// Fitted parabola is c + b·x + a·q; its slope is b + 2a·x
+	float slope, bestSlope = 0;					// Change in cycle duration (μs) per kick delay step around a delay tried
+	byte lo, hi;								// Indices of the delays either side of it
+	byte best;									// Index of the delay where the cycle duration changed least
+	
+	kickDelay = TUNEMIN + (TUNESTEPS - 1) / 2 * TUNESTEP;
+	for (byte i = 0; i < TUNESTEPS; i++) {
+		if (tuneN[i] == 0) {					// If there's a delay we have no measurements for, give up
+			return;
+		}
+		x = i - center;
+		meanX2 += x * x / TUNESTEPS;
+	}
+	for (byte i = 0; i < TUNESTEPS; i++) {
+		x = i - center;
+		q = x * x - meanX2;
+		mean = tuneSum[i] / (float)tuneN[i];
+		m = mean - tuneSum[0] / (float)tuneN[0];
+		sxx += x * x;
+		sqq += q * q;
+		sxm += x * m;
+		sqm += q * m;
+		ss += tuneSum2[i] - tuneSum[i] * mean;
+		dof += tuneN[i] - 1;
+		sqn += q * q / tuneN[i];
+	}
+	b = sxm / sxx;
+	a = sqm / sqq;
+	if (a != 0 && dof > 0 && a * a * sqq * sqq > TUNESIGMA * TUNESIGMA * ss / dof * sqn &&
+			-b / (2 * a) >= -center && -b / (2 * a) <= center) {
+		x = -b / (2 * a);						// A clear vertex among the delays tried: use it
+		kickDelay = TUNEMIN + (int)round((x + center) * TUNESTEP);
+		return;
+	}
+	best = 0;									// Otherwise the vertex says nothing useful. Use the delay tried
+	for (byte i = 0; i < TUNESTEPS; i++) {		//   where the cycle changed least between its neighbours
+		lo = i == 0 ? 0 : i - 1;
+		hi = i == TUNESTEPS - 1 ? i : i + 1;
+		slope = fabs((tuneSum[hi] / (float)tuneN[hi] - tuneSum[lo] / (float)tuneN[lo]) / (hi - lo));
+		if (i == 0 || slope < bestSlope) {
+			best = i;
+			bestSlope = slope;
+		}
+	}
+	kickDelay = TUNEMIN + best * TUNESTEP;
+}
+
+// Make the shadow estimate of beat duration the live one. The live estimate is only ever replaced as a whole, with 
+// interrupts off, so nothing ever sees a mix of old and new values
+template <class Estimator>
+void BasicBendulum<Estimator>::promote() {
+	int32_t fine;								// uspb in 1/FINESCALE μs
+	float age;									// Cycle number at which the shadow estimate applies
+
+	noInterrupts();
+	tickAvg = shadow.getTickAvg();
+	tockAvg = shadow.getTockAvg();
+	uspbFrac = 0;
+	if (tockAvg == 0) {							// If no tockAvg, uspb is tickAvg
+		uspb = tickAvg;
+	} else {									// If both tickAvg and tockAvg, uspb is their average
+		fine = shadow.getCycleFine() / 2;		//   worked out to a fraction of a μs
+		uspb = fine / FINESCALE;
+		uspbFrac = fine % FINESCALE;
+	}
+	if (thermometer != NULL) {					// The live estimate applies at the average temperature of the
+		tempRef = shadow.getCycles() == 0 ? temp : tempFine / (float)(1LL << AVGSHIFT);
+	}											//   cycles it was made from, and at their average cycle number,
+	age = shadow.getCycles() == 0 ? cycleNo : ageFine / (float)(1LL << AVGSHIFT);
+	driftRate += 2 * driftAccel * (age - driftRef) / DRIFTBLOCK;
+	driftRef = age;								//   so move the drift model's rate there
+	liveVar = shadow.getVar();
+#ifndef __AVR__
+	fitLive = false;
+#endif
+	interrupts();
+}
+
+// Say whether the current mode has run its course with the beat just measured. Modes only end on a tock, except
+// CALFINISH, which lasts just one beat, and RUNNING, which never ends by itself.
+template <class Estimator>
+boolean BasicBendulum<Estimator>::modeDone(boolean outlier) {
+	switch (runMode) {
+		case SETTLING:
+			return !tick && ++cycleCounter > tgtSettle;
+		case SCALING:
+			return !tick && ++cycleCounter > tgtScale;
+		case TUNING:							// Done once all the kick delays have been tried
+			return !tick && tuneStep >= TUNESTEPS;
+		case CALIBRATING:						// Done once the estimator says so, or once the spectral
+			return !tick && !outlier &&			//   estimator's average is good enough
+					(shadow.isConverged(tgtSmoothing) || fitDone());
+		case CALFINISH:
+			return true;
+		case STARTING:							// Done once it's been swinging regularly for long enough
+			return !tick && !outlier && ++cycleCounter > STARTGOOD;
+	}
+	return false;
+}
+
+// Finish up the current mode and switch to the one that follows it in nextMode. TUNING is skipped if tgtTune is 0.
+// A bendulum that was already calibrated when it needed STARTING carries on RUNNING rather than being settled and
+// calibrated all over again, unless nextMode says to do something other than that.
+template <class Estimator>
+void BasicBendulum<Estimator>::advance() {
+	byte next = nextMode[runMode];				// The mode to switch to
+
+	switch (runMode) {							// Do whatever needs doing on leaving the current mode
+		case SETTLING:							//   Set the blanking time from the ring-down seen
+			blankTime = constrain(ringTime + ringTime / 2 + BLANKMARGIN, BLANKMIN, BLANKMAX);
+			break;
+		case TUNING:							//   Choose the best kick delay
+			chooseKickDelay();
+			break;
+		case CALIBRATING:						//   If the live estimate was set by hand, we were asked to replace
+			if (liveVar == 0) {					//     it, so do that now
+				promote();
+			}
+			break;
+		case STARTING:
+			if (next == SETTLING && liveVar >= 0) {
+				next = RUNNING;
+			}
+			break;
+	}
+	if (next == TUNING && tgtTune == 0) {
+		next = nextMode[TUNING];
+	}
+	setRunMode(next);							// Switching does whatever needs doing on entering it
+}
+
+// Learn how the duration of a cycle depends on temperature: the slope of a regression of the cycle durations on the
+// temperature readings, kept as running means, variances and covariances over the last TEMPWINDOW cycles. The slope
+// is only used once the temperature has varied by TEMPSPREAD or more and the slope is known well enough that the
+// correction it gives for a typical change in temperature has a standard error of at most TEMPERR μs. Until then, a
+// slope worked out from the little the temperature has varied would mostly be noise.
+template <class Estimator>
+void BasicBendulum<Estimator>::learnTemp(int32_t cycle) {
+	float d;									// Duration of the cycle less tempBase (μs)
+	float dt;									// Deviation of the temperature from the old mean
+	float dd;									// Deviation of the cycle duration from the old mean (μs)
+	float resVar;								// Variance of the cycle durations about the regression line (μs²)
+
+	if (tempN == 0) {							// If first time, start the regression off at this cycle
+		tempBase = cycle;
+		tempMean = temp;
+		cycMean = cycVar = tempVar = tempCov = 0;
+	}
+	if (tempN < TEMPWINDOW) {
+		tempN++;
+	}
+	d = cycle - tempBase;
+	dt = temp - tempMean;
+	dd = d - cycMean;
+	tempMean += dt / tempN;
+	cycMean += dd / tempN;
+	tempVar += (dt * (temp - tempMean) - tempVar) / tempN;
+	cycVar += (dd * (d - cycMean) - cycVar) / tempN;
+	tempCov += (dt * (d - cycMean) - tempCov) / tempN;
+	if (tempVar < TEMPSPREAD * TEMPSPREAD) {
+		return;
+	}
+	resVar = cycVar - tempCov * tempCov / tempVar;
+	if (resVar <= (float)TEMPERR * TEMPERR * tempN) {
+		tempCoef = tempCov / tempVar;
+	}
+}
+
+// Get the amount (μs) by which a beat at the current temperature is longer than one at tempRef, the temperature at
+// which the live estimate applies
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::tempAdjust() {
+	if (thermometer == NULL) {
+		return 0;
+	}
+	return round(tempCoef * (temp - tempRef) / 2);
+}
+
+// Forget the blocks the drift model is fitted to and start a new block at the current cycle. The drift rate and
+// acceleration are kept until there are enough new blocks to fit
+template <class Estimator>
+void BasicBendulum<Estimator>::resetDrift() {
+	for (byte i = 0; i < 5; i++) {
+		driftS[i] = 0;
+	}
+	driftY[0] = driftY[1] = driftY[2] = 0;
+	driftT[0] = driftT[1] = driftT[2] = 0;
+	driftYY = driftYT = driftTT = 0;
+	driftBase = 0;
+	blockStart = cycleNo;
+	blockSum = 0;
+	blockTemp = 0;
+	blockN = 0;
+}
+
+// Add the duration of a cycle, and the temperature, to the current block of the drift model. The cycle isn't
+// corrected for temperature here: early on, the temperature coefficient isn't known yet, and a block corrected with
+// what it was then would stay that way. Instead, the blocks' temperatures are kept alongside, and the correction is
+// made with the coefficient as it is when the model is fitted.
+template <class Estimator>
+void BasicBendulum<Estimator>::learnDrift(int32_t cycle) {
+	if (driftBase == 0) {
+		driftBase = cycle;
+		driftTempBase = temp;
+	}
+	blockSum += cycle - driftBase;
+	blockTemp += temp - driftTempBase;
+	blockN++;
+}
+
+// Finish the current block of the drift model. The blocks are weighted by how recent they are, each one counting
+// 1/DRIFTWINDOW less than the one after it, and the weighted sums are kept in terms of each block's age, in blocks,
+// relative to the newest one. So, first, age the old blocks by one block and reduce their weight. Then add the new
+// one, if at least half of its cycles were measured, and refit.
+template <class Estimator>
+void BasicBendulum<Estimator>::closeBlock() {
+	const float keep = 1 - 1.0 / DRIFTWINDOW;	// Weight an old block keeps as each new one is added
+	float mean;									// Mean cycle duration in the new block, less driftBase (μs)
+	float t;									// Mean temperature in the new block, less driftTempBase
+	byte i;
+
+	driftS[4] -= 4 * driftS[3] - 6 * driftS[2] + 4 * driftS[1] - driftS[0];
+	driftS[3] -= 3 * driftS[2] - 3 * driftS[1] + driftS[0];
+	driftS[2] -= 2 * driftS[1] - driftS[0];
+	driftS[1] -= driftS[0];
+	driftY[2] -= 2 * driftY[1] - driftY[0];
+	driftY[1] -= driftY[0];
+	driftT[2] -= 2 * driftT[1] - driftT[0];
+	driftT[1] -= driftT[0];
+	for (i = 0; i < 5; i++) {
+		driftS[i] *= keep;
+	}
+	for (i = 0; i < 3; i++) {
+		driftY[i] *= keep;
+		driftT[i] *= keep;
+	}
+	driftYY *= keep;
+	driftYT *= keep;
+	driftTT *= keep;
+	if (blockN >= DRIFTBLOCK / 2) {				// A new block has age 0, so only adds to the sums of its 0th powers
+		mean = (float)blockSum / blockN;
+		t = (float)blockTemp / blockN;
+		driftS[0] += 1;
+		driftY[0] += mean;
+		driftYY += mean * mean;
+		driftT[0] += t;
+		driftYT += mean * t;
+		driftTT += t * t;
+		fitDrift();
+	}
+	blockStart += DRIFTBLOCK;
+	blockSum = 0;
+	blockTemp = 0;
+	blockN = 0;
+}
+
+// Fit a polynomial of degree driftOrder in the blocks' ages to their mean cycle durations, corrected for
+// temperature, by weighted least squares. If its highest coefficient isn't at least DRIFTSIGMA standard errors from
+// zero, there's no telling it from noise, so try one degree less. The drift rate and acceleration are then the slope
+// and half the curvature of the fit at driftRef. If even a linear fit shows no drift, there is none.
+template <class Estimator>
+void BasicBendulum<Estimator>::fitDrift() {
+	float m[3][6];								// The normal equations' matrix, then its inverse, alongside the identity
+	float y[3];									// driftY, corrected for temperature
+	float yy;									// driftYY, corrected for temperature
+	float c;									// Temperature coefficient to correct with
+	float b[3];									// The fitted coefficients
+	float f;									// Row multiplier
+	float resVar;								// Variance of the block means about the fit
+	float ref;									// Age of driftRef in blocks
+	byte n;										// Number of coefficients
+	byte i, j, k;
+
+	c = thermometer == NULL ? 0 : tempCoef;
+	for (i = 0; i < 3; i++) {					// A block's mean cycle, corrected, is its mean less c times its
+		y[i] = driftY[i] - c * driftT[i];		//   mean temperature
+	}
+	yy = driftYY - 2 * c * driftYT + c * c * driftTT;
+	for (n = driftOrder + 1; n >= 2; n--) {
+		if (driftS[0] < DRIFTMIN * n) {			// Not enough blocks yet; keep what we have
+			return;
+		}
+		for (i = 0; i < n; i++) {				// Invert the normal equations' matrix by Gauss-Jordan elimination
+			for (j = 0; j < n; j++) {
+				m[i][j] = driftS[i + j];
+				m[i][j + n] = i == j ? 1 : 0;
+			}
+		}
+		for (i = 0; i < n; i++) {
+			f = m[i][i];
+			for (j = 0; j < 2 * n; j++) {
+				m[i][j] /= f;
+			}
+			for (k = 0; k < n; k++) {
+				if (k != i) {
+					f = m[k][i];
+					for (j = 0; j < 2 * n; j++) {
+						m[k][j] -= f * m[i][j];
+					}
+				}
+			}
+		}
+		resVar = yy;							// Work out the coefficients and the residual variance
+		for (i = 0; i < n; i++) {
+			b[i] = 0;
+			for (j = 0; j < n; j++) {
+				b[i] += m[i][j + n] * y[j];
+			}
+			resVar -= b[i] * y[i];
+		}
+		resVar /= driftS[0] > n ? driftS[0] - n : 1;
+		if (resVar < 0) {
+			resVar = 0;
+		}
+		if (b[n - 1] * b[n - 1] >= DRIFTSIGMA * DRIFTSIGMA * resVar * m[n - 1][2 * n - 1]) {
+			ref = (driftRef - (blockStart + DRIFTBLOCK / 2)) / DRIFTBLOCK;
+			driftAccel = n > 2 ? b[2] : 0;		// The newest block is centred DRIFTBLOCK / 2 cycles after it started
+			driftRate = b[1] + 2 * driftAccel * ref;
+			return;
+		}
+	}
+	driftRate = driftAccel = 0;
+}
+
+// Get the amount (μs) by which a beat now is longer than one at driftRef, the cycle at which the live estimate
+// applies
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::driftAdjust() {
+	float d = (cycleNo - driftRef) / DRIFTBLOCK;	// Blocks since driftRef
+
+	if (driftOrder == 0) {
+		return 0;
+	}
+	return round((driftRate + driftAccel * d) * d / 2);
+}
+
+// Say whether the live estimate is the average of the spectral estimator's estimates and its standard error is
+// below FITTARGET μs. Never on AVRs, which have no spectral estimator.
+template <class Estimator>
+boolean BasicBendulum<Estimator>::fitDone() {
+#ifndef __AVR__
+	return fitLive && liveVar > 0 && liveVar < FITTARGET * FITTARGET;
+#else
+	return false;
+#endif
+}
+
+#ifndef __AVR__
+// Start the spectral estimator off with the calibrated cycle duration, if there is one, or else with the first cycle
+// measured, so that it has homed in on the bendulum by the time CALIBRATING begins. While CALIBRATING, average the
+// estimates from its windows, leaving out the first, which started before CALIBRATING did. Successive estimates
+// aren't independent -- each window's estimate starts from the last one's, and the bendulum's own wander carries
+// over from one window to the next -- so the variance of their average is worked out from both their variance and
+// the covariance of successive ones. Once there are FITMIN of them, if their average is better than the live
+// estimate, make it the live one, split into ticks and tocks the way the shadow estimate splits them.
+template <class Estimator>
+void BasicBendulum<Estimator>::useFit() {
+	double cycle;								// The latest estimate, corrected for the Arduino clock (μs)
+	float d;									// It less fitBase (μs)
+	float mean;									// Mean of the estimates less fitBase (μs)
+	float var;									// Variance of the estimates (μs²)
+	float cov;									// Covariance of successive estimates (μs²)
+	int32_t fine;								// Half the average, in 1/FINESCALE μs
+	int32_t diff;								// Amount (μs) by which ticks are longer than tocks
+
+	if (!fit->isStarted()) {
+		if (liveVar >= 0 && tockAvg != 0) {
+			fit->begin(tickAvg + tockAvg);
+		} else if (runMode != STARTING && tickPeriod != 0 && tockPeriod != 0) {
+			fit->begin(tickPeriod + tockPeriod);
+		}
+		fitSeen = 0;
+		return;
+	}
+	if (fit->getWindows() == fitSeen) {			// Nothing new
+		return;
+	}
+	fitSeen = fit->getWindows();
+	if (runMode != CALIBRATING) {
+		return;
+	}
+	if (fitN < 0) {								// The first window isn't all CALIBRATING
+		fitN = 0;
+		return;
+	}
+	cycle = fit->getPeriod();
+	cycle += cycle * bias / 864000.0;
+	if (fitN == 0) {
+		fitBase = cycle;
+	}
+	d = cycle - fitBase;
+	if (fitN > 0) {
+		fitSumLag += d * fitLast;
+	}
+	fitLast = d;
+	fitSum += d;
+	fitSum2 += d * d;
+	fitTemp += temp;
+	fitN++;
+	if (fitN < FITMIN) {
+		return;
+	}
+	mean = fitSum / fitN;
+	var = fitSum2 / fitN - mean * mean;
+	cov = fitSumLag / (fitN - 1) - mean * mean;
+	var = (var + 2 * cov > var / fitN ? var + 2 * cov : var / fitN) / fitN;
+	if (var < 1e-6) {							// (Zero would mean the estimate was set by hand)
+		var = 1e-6;
+	}
+	if (liveVar >= 0 && var >= liveVar) {
+		return;
+	}
+	diff = shadow.getTockAvg() == 0 ? 0 : shadow.getTickAvg() - shadow.getTockAvg();
+	noInterrupts();
+	fine = round((fitBase + mean) * FINESCALE / 2);
+	uspb = fine / FINESCALE;
+	uspbFrac = fine % FINESCALE;
+	tickAvg = uspb + diff / 2;
+	tockAvg = 2 * uspb - tickAvg;
+	if (thermometer != NULL) {					// It applies at the average temperature and halfway through the
+		tempRef = fitTemp / fitN;				//   windows averaged, so move the drift model's rate there
+	}
+	driftRate += 2 * driftAccel * (cycleNo - fitN * FITCYCLES / 2.0 - driftRef) / DRIFTBLOCK;
+	driftRef = cycleNo - fitN * FITCYCLES / 2.0;
+	liveVar = var;
+	fitLive = true;
+	interrupts();
+}
+#endif
+
+// Do one cycle (two beats) return length of a cycle in μs
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::cycle() {
+	return beat() + beat();						// Do two beats, return how long it took
+}
+
+/*
+ *
+ * Getters and setters
+ *
+ */
+// Get the number of cycles we've been in the current mode
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::getCycleCounter(){
+	if (runMode == RUNNING) return -1;			// We don't count this since it could be huge
+	if (runMode == CALIBRATING) return shadow.getCycles() + 1;
+	return cycleCounter;
+}
+ 
+ // Set target smoothing interval in beats
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::getTgtSmoothing(){
+	return tgtSmoothing;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setTgtSmoothing(int32_t interval){
+	tgtSmoothing = interval;
+}
+
+// Get/set the number of cycles to measure each kick delay for in TUNING mode, at most TUNEMAX. 0, the default, means
+// skip TUNING altogether
+template <class Estimator>
+int BasicBendulum<Estimator>::getTgtTune(){
+	return tgtTune;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setTgtTune(int interval){
+	tgtTune = constrain(interval, 0, TUNEMAX);
+}
+
+// Set current smoothing interval in beats
+template <class Estimator>
+int BasicBendulum<Estimator>::getTgtSettle(){
+	return tgtSettle;
+}
+
+// Set target settling interval in beats
+template <class Estimator>
+void BasicBendulum<Estimator>::setTgtSettle(int interval){
+	tgtSettle = interval;
+}
+
+// Get, set or increment Arduino clock run rate correction in tenths of a second per day
+template <class Estimator>
+int BasicBendulum<Estimator>::getBias(){
+	return bias;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setBias(int factor){
+	bias = factor;
+}
+template <class Estimator>
+int BasicBendulum<Estimator>::incrBias(int factor){
+	bias += factor;
+	return bias;
+}
+
+// Get/set the value of peakScale -- the scaling factor by which induced coil voltage readings is divided
+template <class Estimator>
+int BasicBendulum<Estimator>::getPeakScale() {
+	return peakScale;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setPeakScale(int scaleFactor) {
+	peakScale = scaleFactor;
+}
+
+// Was the last beat a "tick" or a "tock"?
+template <class Estimator>
+boolean BasicBendulum<Estimator>::isTick() {
+	return tick;
+}
+
+// Get average beats per minute
+template <class Estimator>
+float BasicBendulum<Estimator>::getAvgBpm(){
+	if ((tickAvg + tockAvg) == 0) return 0;
+	return 120000000.0 / (tickAvg + tockAvg);
+}
+
+// Get current beats per minute
+template <class Estimator>
+float BasicBendulum<Estimator>::getCurBpm(){
+	uint32_t diff;
+	if (lastTime == 0 || timeBeforeLast == 0) return 0;
+	diff = lastTime - timeBeforeLast;
+	return 60000000.0 / (diff + ((long long)bias * diff + 432000) / 864000);
+}
+
+// Get the current ratio of tick length to tock length
+template <class Estimator>
+float BasicBendulum<Estimator>::getDelta(){
+	if (tickPeriod == 0 || tockPeriod == 0) return 0;
+	return (float)tickPeriod / tockPeriod;
+}
+
+// Get or set the beat duration in μs or increment it in tenths of a second per day
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::getBeatDuration(){
+	return uspb;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setBeatDuration(int32_t beatDur) {
+	uspb = tickAvg = tockAvg = beatDur;
+	tempRef = temp;
+	driftRef = cycleNo;
+	uspbFrac = 0;
+	liveVar = 0;							// Set by hand, so the shadow estimate mustn't replace it
+}
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::incrBeatDuration(int32_t incr) {
+	if (uspb < 1) {							// If uspb not set
+		return 0;							//   can't adjust it
+	}
+	tickAvg = tockAvg = uspb = round(uspb * (1 + incr / 864000.0));
+	uspbFrac = 0;
+	liveVar = 0;							// Set by hand, so the shadow estimate mustn't replace it
+	return uspb;
+}
+
+
+// Get the number of beats rejected by the outlier filter since last (re)starting or calibrating
+template <class Estimator>
+unsigned int BasicBendulum<Estimator>::getRejects() {
+	return rejects;
+}
+
+// Get the standard error of the live beat duration estimate in μs. 0 means it was set by hand, < 0 that it's unknown
+template <class Estimator>
+float BasicBendulum<Estimator>::getUncertainty() {
+	if (liveVar <= 0) return liveVar;
+	return sqrt(liveVar) / 2;					// liveVar is for a cycle, which is two beats
+}
+
+// Get the duration in μs of the last beat, as returned by beat()
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::getLastBeat() {
+	return beatDur;
+}
+
+// Get the clock time (μs), as returned by micros(), of the pass that ended the last beat
+template <class Estimator>
+uint32_t BasicBendulum<Estimator>::getPassTime() {
+	return lastTime;
+}
+
+// Get/set the kick policy for RUNNING mode: a kick is given at least every kickEvery beats, and, in between, 
+// whenever the peak read from the coil during a pass is below kickThreshold
+template <class Estimator>
+byte BasicBendulum<Estimator>::getKickEvery() {
+	return kickEvery;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setKickEvery(byte beats) {
+	kickEvery = beats < 1 ? 1 : beats;
+}
+template <class Estimator>
+int BasicBendulum<Estimator>::getKickThreshold() {
+	return kickThreshold;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setKickThreshold(int threshold) {
+	kickThreshold = threshold;
+}
+
+// Get the peak value read from the coil during the last pass
+template <class Estimator>
+int BasicBendulum<Estimator>::getPeak() {
+	return peak;
+}
+
+// Get/set the time in ms from detecting a pass to starting the kick (chosen automatically in TUNING mode)
+template <class Estimator>
+int BasicBendulum<Estimator>::getKickDelay() {
+	return kickDelay;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setKickDelay(int delayTime) {
+	kickDelay = delayTime;
+}
+
+// Get/set the time in ms the coil is ignored after a kick (set automatically at the end of SETTLING mode)
+template <class Estimator>
+int BasicBendulum<Estimator>::getBlankTime() {
+	return blankTime;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setBlankTime(int ms) {
+	blankTime = ms;
+}
+
+// Set the function to call, over and over, while the coil is being ignored after a kick (NULL for none). It should
+// take well under IDLEMARGIN ms each time.
+template <class Estimator>
+void BasicBendulum<Estimator>::setIdle(void (*idleFn)()) {
+	idle = idleFn;
+}
+
+// Set the function that reads the temperature (NULL for none). It's invoked once a beat while the coil is being
+// ignored, and should return a reading in any units in which a thermistor's or sensor's reading is roughly linear
+// in temperature -- e.g. hundredths of a degree or a raw analogRead() -- and take well under IDLEMARGIN ms. The
+// reading taken now is taken to be the temperature at which the live beat duration estimate applies until there's
+// a better one.
+template <class Estimator>
+void BasicBendulum<Estimator>::setThermometer(int (*thermFn)()) {
+	thermometer = thermFn;
+	if (thermometer != NULL) {
+		temp = tempRef = thermometer();
+	}
+}
+
+// Set the function to tell when the coil is being watched (NULL for none). It's invoked with true when the
+// Bendulum object starts watching the coil for the bendulum to pass and with false once it has passed or timedBeat()
+// has given up. When RUNNING, the watch starts WATCHMARGIN ms before the next pass is due, or sooner if the coil
+// shows the bendulum coming early; otherwise it starts once the blanking time after the kick is over, and in
+// SETTLING mode, the ring-down after each kick is watched, too. In between, anything that might disturb the coil's
+// readings or their timing, like an interrupt-driven display, should be held off. Like idle, it must be quick.
+template <class Estimator>
+void BasicBendulum<Estimator>::setWatch(void (*watchFn)(boolean watching)) {
+	watch = watchFn;
+}
+
+// Get the latest temperature reading
+template <class Estimator>
+int BasicBendulum<Estimator>::getTemperature() {
+	return temp;
+}
+
+// Get/set the change in the duration of a cycle (μs) per unit rise in temperature. It's learned as the bendulum runs
+// but can be set, e.g., from a saved calibration
+template <class Estimator>
+float BasicBendulum<Estimator>::getTempCoef() {
+	return tempCoef;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setTempCoef(float coef) {
+	tempCoef = coef;
+}
+
+// Get/set the temperature at which the live beat duration estimate applies. Set it along with the beat duration it
+// goes with
+template <class Estimator>
+float BasicBendulum<Estimator>::getTempRef() {
+	return tempRef;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setTempRef(float ref) {
+	tempRef = ref;
+}
+
+// Get/set the order of the drift model: 0 for none, 1 for a steady drift or 2 for one that changes steadily
+template <class Estimator>
+byte BasicBendulum<Estimator>::getDriftOrder() {
+	return driftOrder;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setDriftOrder(byte order) {
+	driftOrder = order > 2 ? 2 : order;
+	if (driftOrder < 2) {
+		driftAccel = 0;
+	}
+}
+
+// Get/set the drift rate, the change in the duration of a cycle (μs) per DRIFTBLOCK cycles, and its acceleration,
+// half the change in the rate per DRIFTBLOCK cycles, at the time the live beat duration estimate applies. They're
+// learned as the bendulum runs but can be set, e.g., from a saved calibration, along with the beat duration they go
+// with
+template <class Estimator>
+float BasicBendulum<Estimator>::getDriftRate() {
+	return driftRate;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setDriftRate(float rate) {
+	driftRate = rate;
+}
+template <class Estimator>
+float BasicBendulum<Estimator>::getDriftAccel() {
+	return driftAccel;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setDriftAccel(float accel) {
+	driftAccel = accel;
+}
+
+#ifndef __AVR__
+// Pass the coil readings taken while watching for the bendulum to estimator, a spectral period estimator (see
+// BendulumFit.h), or, if estimator is NULL, stop doing so
+template <class Estimator>
+void BasicBendulum<Estimator>::setFit(BendulumFit *estimator) {
+	fit = estimator;
+}
+#endif
+
+// Get how much longer, in μs, a beat is if the kick at its start is skipped
+template <class Estimator>
+int32_t BasicBendulum<Estimator>::getCoastDelta() {
+	return coastDelta;
+}
+
+// Get/set whether the bendulum is switched to STARTING mode automatically if it stops
+template <class Estimator>
+boolean BasicBendulum<Estimator>::getAutoStart() {
+	return autoStart;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setAutoStart(boolean enable) {
+	autoStart = enable;
+}
+
+// Get/set the current run mode -- SETTLING, CALIBRATING or RUNNING
+template <class Estimator>
+int BasicBendulum<Estimator>::getRunMode(){
+	return runMode;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setRunMode(byte mode){
+	switch (mode) {
+		case SETTLING:						//   Switch to settling mode
+			runMode = SETTLING;
+			cycleCounter = 1;				//     Reset cycle counter
+			rejects = 0;					//     Reset outlier count
+			liveVar = -1;					//     uspb will be whatever we measure, so no longer calibrated
+			blankTime = BLANKMAX;			//     Measure the ring-down afresh
+			ringTime = 0;
+			resetDrift();					//     Kick delay may change, so start the drift model's blocks over
+			break;
+		case SCALING:						//   Switch to scaling mode
+			runMode = SCALING;
+			cycleCounter = 1;				//     Reset cycle counter
+			peakScale = 10;					//     Reset peakScale
+			break;
+		case CALIBRATING:					//   Switch to calibrating mode
+			runMode = CALIBRATING;
+			shadow.reset();					//     Reset shadow estimate; the live one stays in use until
+											//       the shadow one is better
+			tempFine = ageFine = 0;
+			rejects = 0;					//     Reset outlier count
+#ifndef __AVR__
+			fitN = -1;						//     Start averaging the spectral estimator's estimates afresh
+			fitLast = fitSum = fitSum2 = fitSumLag = fitTemp = 0;
+			fitLive = false;
+#endif
+			break;
+		case CALFINISH:						//   Switch to calibration finished mode
+			runMode = CALFINISH;
+			break;
+		case RUNNING:						//   Switch to running mode
+			runMode = RUNNING;
+			break;
+		case TUNING:						//   Switch to tuning mode
+			runMode = TUNING;
+			cycleCounter = 1;				//     Reset cycle counter
+			tuneStep = 0;					//     Start with the shortest kick delay
+			kickDelay = TUNEMIN;
+			tuneBase = 0;
+			for (byte i = 0; i < TUNESTEPS; i++) {
+				tuneSum[i] = 0;
+				tuneSum2[i] = 0;
+				tuneN[i] = 0;
+			}
+			break;
+		case STARTING:						//   Switch to starting mode
+			runMode = STARTING;
+			cycleCounter = 1;				//     Reset cycle counter
+			startPeriod = STARTMAX;			//     Start the sweep from the top
+			startCount = 0;
+			break;
+	}
+}
+
+// Get/set the mode that follows mode when it has run its course. By default, SETTLING is followed by SCALING,
+// SCALING by TUNING, TUNING by CALIBRATING, CALIBRATING by CALFINISH, CALFINISH by RUNNING and STARTING by SETTLING.
+template <class Estimator>
+byte BasicBendulum<Estimator>::getNextMode(byte mode) {
+	return mode < MODES ? nextMode[mode] : mode;
+}
+template <class Estimator>
+void BasicBendulum<Estimator>::setNextMode(byte mode, byte next) {
+	if (mode < MODES && next < MODES) {
+		nextMode[mode] = next;
+	}
+}
@@ -0,0 +1,80 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumCommand.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   A BendulumCommand object lets a running Bendulum object be adjusted over a serial line, without editing and
+ *   reloading the sketch and so losing hours of calibration. It reads whatever characters have arrived, never
+ *   waiting for more, and carries out a command each time a whole line has come in. A command is a letter, then,
+ *   for most of them, a number:
+ *
+ *       b n     setBias(n)
+ *       i n     incrBias(n)
+ *       s n     setTgtSmoothing(n)
+ *       p n     setPeakScale(n)
+ *       d n     setBeatDuration(n)
+ *       m n     setRunMode(n)
+ *       ?       Report the status
+ *
+ *   Each command is answered with a line giving the letter and the value that was set, e.g. "b 12" for the bias.
+ *   A "?" is answered with "? mode uspb bias peakScale tgtSmoothing rejects". A line that isn't a command is
+ *   answered with "!". Lines longer than CMDSIZE - 1 characters aren't commands, and neither is an "m" for a mode
+ *   that doesn't exist, an "s" for less than 1 or more than CMDMAXSMOOTH cycles, a "p" for less than 1 or more
+ *   than CMDMAXSCALE, a "d" for less than 1 or more than CMDMAXBEAT μs, or a "b" or "i" that would leave the bias
+ *   more than CMDMAXBIAS either side of zero.
+ *
+ *   To keep it from disturbing the timing of the bendulum, have the Bendulum object poll it while the coil is being
+ *   ignored after a kick:
+ *
+ *       Bendulum myBendulum;
+ *       BendulumCommand command(myBendulum, Serial);
+ *       void idle() {
+ *           command.poll();
+ *       }
+ *       void setup() {
+ *           Serial.begin(9600);
+ *           myBendulum.setIdle(idle);
+ *       }
+ *
+ *   poll() does at most one command each time it's invoked, and only once the stream's transmit buffer has room for
+ *   any answer, CMDREPLY characters, so it never holds things up for long. Until then, the command waits. The stream
+ *   has to say how much room there is with availableForWrite(), as HardwareSerial does.
+ *
+ ****/
+
+#ifndef BendulumCommand_H
+#define BendulumCommand_H
+
+#include "Bendulum.h"
+
+#define CMDSIZE		(16)						// Size of the buffer for a command line, including the terminating '\0'
+#define CMDMAXSMOOTH	(10000000L)				// Longest smoothing interval (cycles) "s" sets; months of cycles
+#define CMDMAXSCALE		(1023)					// Largest peak scaling "p" sets; no coil reading is bigger
+#define CMDMAXBEAT		(5000000L)				// Longest beat duration (μs) "d" sets; longer beats are outliers
+#define CMDMAXBIAS		(32767)					// Largest bias, either way, "b" and "i" leave; the most an int holds
+#define CMDREPLY		(40)					// Room (characters) the longest answer, to "?", needs to be sent
+
+template <class Estimator = RunningMean>
+class BasicBendulumCommand {
+private:
+	BasicBendulum<Estimator> &bendulum;		// The Bendulum object being adjusted
+	Stream &stream;							// Where commands come from and answers go
+	char line[CMDSIZE];						// The command line so far
+	byte length;							// Number of characters in line
+	boolean tooLong;						// Whether the command line has overflowed line
+
+	void execute();							// Carry out the command in line and answer it
+
+public:
+	BasicBendulumCommand(BasicBendulum<Estimator> &target, Stream &io);
+	void poll();							// Read what has arrived; carry out at most one command
+};
+
+typedef BasicBendulumCommand<RunningMean> BendulumCommand;	// Commands for the usual Bendulum
+
+#include "BendulumCommand.tpp"				// The member functions
+
+#endif
@@ -0,0 +1,155 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumCommand.tpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See BendulumCommand.h for a description of the commands and how to use them. This file is included at the end
+ *   of BendulumCommand.h, since a class template's member functions have to be seen wherever it's used.
+ *
+ ****/
+
+/*
+ *
+ * Constructor
+ *
+ */
+// Instantiate a BendulumCommand object that adjusts target according to the commands that arrive on io
+template <class Estimator>
+BasicBendulumCommand<Estimator>::BasicBendulumCommand(BasicBendulum<Estimator> &target, Stream &io) :
+		bendulum(target), stream(io) {
+	length = 0;								// Nothing received yet
+	tooLong = false;
+}
+
+/*
+ *
+ * Public methods
+ *
+ */
+// Read whatever characters have arrived, without waiting for any more. If that completes a command line, carry it
+// out and return, leaving anything after it for next time. A command isn't carried out until there's room to send
+// its answer without waiting, so until then, the end of its line is left unread.
+template <class Estimator>
+void BasicBendulumCommand<Estimator>::poll() {
+	int c;										// The character read
+
+	while (stream.available() > 0) {
+		c = stream.peek();
+		if (c == '\r' || c == '\n') {			// If it's the end of a line
+			if (length == 0 && !tooLong) {		//   Ignore empty lines (and the '\n' of "\r\n")
+				stream.read();
+				continue;
+			}
+			if (stream.availableForWrite() < CMDREPLY) {
+				return;							//   Wait for room to answer
+			}
+			stream.read();
+			line[length] = '\0';
+			if (tooLong) {
+				stream.println("!");
+			} else {
+				execute();
+			}
+			length = 0;
+			tooLong = false;
+			return;
+		}
+		stream.read();
+		if (length < CMDSIZE - 1) {				// Otherwise add it to the line, if there's room
+			line[length++] = c;
+		} else {
+			tooLong = true;
+		}
+	}
+}
+
+/*
+ *
+ * Private methods
+ *
+ */
+// Carry out the command in line and answer it
+template <class Estimator>
+void BasicBendulumCommand<Estimator>::execute() {
+	char *end;									// Where the number in the command ended
+	long value = strtol(line + 1, &end, 10);	// The number in the command
+	boolean hasValue = end != line + 1;			// Whether there was one
+	char command = line[0];						// The command letter
+
+	while (*end == ' ') {						// Nothing but blanks may follow the number
+		end++;
+	}
+	if (*end != '\0' || (hasValue == (command == '?'))) {
+		stream.println("!");
+		return;
+	}
+	switch (command) {
+		case 'i':								// Increment the bias; it's answered as the bias it set
+			value += bendulum.getBias();
+			command = 'b';
+			// fall through
+		case 'b':
+			if (value < -CMDMAXBIAS || value > CMDMAXBIAS) {
+				stream.println("!");
+				return;
+			}
+			bendulum.setBias(value);
+			value = bendulum.getBias();
+			break;
+		case 's':
+			if (value < 1 || value > CMDMAXSMOOTH) {
+				stream.println("!");
+				return;
+			}
+			bendulum.setTgtSmoothing(value);
+			value = bendulum.getTgtSmoothing();
+			break;
+		case 'p':
+			if (value < 1 || value > CMDMAXSCALE) {
+				stream.println("!");
+				return;
+			}
+			bendulum.setPeakScale(value);
+			value = bendulum.getPeakScale();
+			break;
+		case 'd':
+			if (value < 1 || value > CMDMAXBEAT) {
+				stream.println("!");
+				return;
+			}
+			bendulum.setBeatDuration(value);
+			value = bendulum.getBeatDuration();
+			break;
+		case 'm':
+			if (value < 0 || value >= MODES) {
+				stream.println("!");
+				return;
+			}
+			bendulum.setRunMode(value);
+			value = bendulum.getRunMode();
+			break;
+		case '?':								// Status: mode, uspb, bias, peakScale, tgtSmoothing, rejects
+			stream.print("? ");
+			stream.print((long)bendulum.getRunMode());
+			stream.print(' ');
+			stream.print(bendulum.getBeatDuration());
+			stream.print(' ');
+			stream.print((long)bendulum.getBias());
+			stream.print(' ');
+			stream.print((long)bendulum.getPeakScale());
+			stream.print(' ');
+			stream.print((long)bendulum.getTgtSmoothing());
+			stream.print(' ');
+			stream.println((long)bendulum.getRejects());
+			return;
+		default:
+			stream.println("!");
+			return;
+	}
+	stream.print(command);
+	stream.print(' ');
+	stream.println(value);
+}
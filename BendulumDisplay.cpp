@@ -0,0 +1,279 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumDisplay.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See BendulumDisplay.h for a description of what a BendulumDisplay object does and how to use it.
+ *
+ ****/
+
+#define BENDULUM_NO_ISR							// The handler is for the sketch (see BendulumDisplay.h)
+#include "BendulumDisplay.h"
+
+#ifdef __AVR__
+
+BendulumDisplay *BendulumDisplay::active = NULL;
+
+// The segments lit for each decimal digit: bit 0 is segment a, bit 1 segment b, and so on to bit 6, segment g
+static const byte font[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+/*
+ *
+ * Constructor
+ *
+ */
+// Instantiate a BendulumDisplay object. It does nothing until begin() is invoked.
+BendulumDisplay::BendulumDisplay() {
+	digits = 0;
+	ports = 0;
+	second = 0;
+	micro = 0;
+	frontSecond = -1;
+	backSecond = -1;
+	started = false;
+	timeSet = false;
+	lastPass = 0;
+	suspended = false;
+	front = 0;
+	digit = 0;
+	countdown = 0;
+	flipped = false;
+}
+
+/*
+ *
+ * Public methods
+ *
+ */
+// Set up the display on the segment pins segPins (eight of them: segments a through g and the decimal point) and the
+// digit pins digitPins (nDigits of them, 4 or 6, left to right). segLevel is what lights a segment, HIGH or LOW, and
+// digitLevel what lights a digit. Then take Timer2 over to refresh it. Return false, and do nothing, if there are too
+// many digits or the segment pins are on more than DISPLAYPORTS I/O ports.
+boolean BendulumDisplay::begin(const byte *segPins, const byte *digitPins, byte nDigits, byte segLevel,
+		byte digitLevel) {
+	volatile uint8_t *port;					// The I/O port a pin is on
+	byte p;									// Index into segPort
+
+	if (nDigits != 4 && nDigits != 6) {
+		return false;
+	}
+	ports = 0;
+	for (byte i = 0; i < 8; i++) {			// Find the I/O ports the segment pins are on
+		if (digitalPinToPort(segPins[i]) == NOT_A_PIN) {
+			return false;
+		}
+		port = portOutputRegister(digitalPinToPort(segPins[i]));
+		for (p = 0; p < ports && segPort[p] != port; p++) {
+		}
+		if (p == ports) {
+			if (ports == DISPLAYPORTS) {
+				return false;
+			}
+			segPort[ports] = port;
+			segMask[ports++] = 0;
+		}
+		segPortNo[i] = p;
+		segBit[i] = digitalPinToBitMask(segPins[i]);
+		segMask[p] |= segBit[i];
+	}
+	for (byte i = 0; i < nDigits; i++) {
+		if (digitalPinToPort(digitPins[i]) == NOT_A_PIN) {
+			return false;
+		}
+		digitPort[i] = portOutputRegister(digitalPinToPort(digitPins[i]));
+		digitBit[i] = digitalPinToBitMask(digitPins[i]);
+	}
+	digits = nDigits;
+	segOn = segLevel;
+	digitHigh = digitLevel == HIGH;
+	for (byte i = 0; i < 8; i++) {			// All the segments off
+		digitalWrite(segPins[i], segOn == HIGH ? LOW : HIGH);
+		pinMode(segPins[i], OUTPUT);
+	}
+	for (byte i = 0; i < digits; i++) {		// All the digits off
+		digitalWrite(digitPins[i], digitHigh ? LOW : HIGH);
+		pinMode(digitPins[i], OUTPUT);
+	}
+	frontSecond = -1;
+	update();
+	noInterrupts();
+	active = this;
+	TCCR2A = _BV(WGM21);					// Clear timer on compare match
+	TCCR2B = _BV(CS22);						// Clock / 64
+	OCR2A = (F_CPU / 64000L) * DISPLAYTICK / 1000 - 1;
+	TCNT2 = 0;
+	TIFR2 = _BV(OCF2A);
+	TIMSK2 = _BV(OCIE2A);					// Interrupt on compare match
+	interrupts();
+	return true;
+}
+
+// Set the time of day to hour:minute:sec as of now and show it
+void BendulumDisplay::setTime(byte hour, byte minute, byte sec) {
+	second = ((long)hour * 60 + minute) * 60 + sec;
+	if (started) {							// Count the bendulum's time from now
+		micro = -(long)(micros() - lastPass);
+	} else {								// Or, until the first beat, from the Arduino clock's
+		micro = 0;
+		lastPass = micros();
+	}
+	timeSet = true;
+	update();
+}
+
+// Get the time of day (s since midnight) as of the last pass
+long BendulumDisplay::getTime() {
+	return second;
+}
+
+// Add a beat of beatDur μs, as returned by beat(), that ended at clock time passTime, as returned by getPassTime(),
+// and bring the display up to date. Until the first beat, the time runs by the Arduino's clock.
+void BendulumDisplay::addBeat(long beatDur, unsigned long passTime) {
+	if (started) {
+		micro += beatDur;
+	} else if (timeSet) {
+		micro += passTime - lastPass;
+	}
+	started = true;
+	lastPass = passTime;
+	while (micro >= 1000000L) {
+		micro -= 1000000L;
+		if (++second >= 86400L) {
+			second = 0;
+		}
+	}
+	update();
+}
+
+// Tell the display whether the coil is being watched. Pass this to the Bendulum object's setWatch().
+void BendulumDisplay::watch(boolean watching) {
+	if (active != NULL) {
+		active->suspend(watching);
+	}
+}
+
+// Handle Timer2's compare A interrupt: switch to the other frame if the next second has started, and light the next
+// digit
+void BendulumDisplay::refresh() {
+	const byte *f;							// What to write to the segment pins' ports for the digit
+
+	if (countdown != 0 && --countdown == 0) {
+		front ^= 1;
+		flipped = true;
+	}
+	if (digitHigh) {						// Current digit off
+		*digitPort[digit] &= ~digitBit[digit];
+	} else {
+		*digitPort[digit] |= digitBit[digit];
+	}
+	if (++digit >= digits) {
+		digit = 0;
+	}
+	f = frame[front][digit];
+	for (byte p = 0; p < ports; p++) {		// Its segments
+		*segPort[p] = (*segPort[p] & ~segMask[p]) | f[p];
+	}
+	if (digitHigh) {						// Next digit on
+		*digitPort[digit] |= digitBit[digit];
+	} else {
+		*digitPort[digit] &= ~digitBit[digit];
+	}
+}
+
+/*
+ *
+ * Private methods
+ *
+ */
+// Work out frame f so it shows the time of day s (s since midnight): HH MM or HH MM SS, with the leading zero of the
+// hours blank and the decimal point after them lit in even seconds
+void BendulumDisplay::render(byte f, long s) {
+	byte lit[DISPLAYMAX];					// The segments lit in each digit
+	byte hour = s / 3600;
+	byte minute = s / 60 % 60;
+	byte sec = s % 60;
+
+	lit[0] = hour < 10 ? 0 : font[hour / 10];
+	lit[1] = font[hour % 10] | (sec % 2 == 0 ? _BV(DISPLAYDP) : 0);
+	lit[2] = font[minute / 10];
+	lit[3] = font[minute % 10];
+	lit[4] = font[sec / 10];
+	lit[5] = font[sec % 10];
+	for (byte d = 0; d < digits; d++) {
+		for (byte p = 0; p < ports; p++) {
+			frame[f][d][p] = 0;
+		}
+		for (byte i = 0; i < 8; i++) {		// Set the bits of the pins that are to be high
+			if ((((lit[d] >> i) & 1) != 0) == (segOn == HIGH)) {
+				frame[f][d][segPortNo[i]] |= segBit[i];
+			}
+		}
+	}
+}
+
+// Show the second that's current now, if that's not already showing, and work out the other frame to show the next
+// one. Have refresh() switch to it when it starts.
+void BendulumDisplay::update() {
+	long pos = micro + (long)(micros() - lastPass);	// Time (μs) now since the start of second
+	long s = second;						// The second now
+	unsigned int ticks;						// Number of ticks until the next second
+
+	while (pos >= 1000000L) {
+		pos -= 1000000L;
+		if (++s >= 86400L) {
+			s = 0;
+		}
+	}
+	noInterrupts();							// Stop refresh() switching frames while we work on them
+	countdown = 0;
+	if (flipped) {
+		frontSecond = backSecond;
+		flipped = false;
+	}
+	interrupts();
+	if (frontSecond != s) {
+		render(front ^ 1, s);
+		front ^= 1;
+		frontSecond = s;
+	}
+	backSecond = s + 1 < 86400L ? s + 1 : 0;
+	render(front ^ 1, backSecond);
+	ticks = pos < 0 ? 1000000L / DISPLAYTICK : (1000000L - pos) / DISPLAYTICK;
+	noInterrupts();
+	countdown = ticks > 0 ? ticks : 1;
+	interrupts();
+}
+
+// Suspend the display, dark and without interrupts, while the coil is being watched, and resume it afterwards,
+// allowing for the ticks missed while it was suspended
+void BendulumDisplay::suspend(boolean watching) {
+	unsigned long missed;					// Number of ticks missed
+
+	if (watching) {
+		if (!suspended) {
+			TIMSK2 &= ~_BV(OCIE2A);
+			if (digitHigh) {
+				*digitPort[digit] &= ~digitBit[digit];
+			} else {
+				*digitPort[digit] |= digitBit[digit];
+			}
+			suspendedAt = micros();
+			suspended = true;
+		}
+	} else if (suspended) {
+		missed = (micros() - suspendedAt) / DISPLAYTICK;
+		noInterrupts();
+		if (countdown != 0) {
+			countdown = countdown > missed ? countdown - missed : 1;
+		}
+		TIFR2 = _BV(OCF2A);
+		TIMSK2 |= _BV(OCIE2A);
+		interrupts();
+		suspended = false;
+	}
+}
+
+#endif
@@ -0,0 +1,120 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumDisplay.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   A BendulumDisplay object shows a bendulum's time of day on a multiplexed 7-segment LED display of 4 (HH MM) or
+ *   6 (HH MM SS) digits, with the decimal point after the hours digits blinking once a second as the colon. The
+ *   sketch doesn't have to do anything to keep it lit: the AVR's Timer2 interrupts every DISPLAYTICK μs and the
+ *   interrupt handler lights the next digit. The segment patterns are worked out ahead of time, once a second, as
+ *   the bytes to write to each I/O port the segment pins are on, so the interrupt handler only has to write them,
+ *   which takes a few μs.
+ *
+ *   The time is the sum of the beat durations beat() returns, counted from setTime(), like a BendulumPPS object's.
+ *   After each beat, addBeat() adds the beat's duration and works out the frame for the second after the current
+ *   one; the interrupt handler counts down to the start of that second and switches to it then.
+ *
+ *   Lighting LEDs and taking interrupts while the Bendulum object is watching the coil would disturb the readings
+ *   and their timing. So the Bendulum object is given BendulumDisplay::watch() through setWatch(), and the display
+ *   goes dark and its interrupts stop whenever the coil is being watched. When the Bendulum object is RUNNING, that's
+ *   only from WATCHMARGIN ms before the bendulum is due to pass until it has passed, so the display is lit for most of
+ *   each beat. Before then, it's dark from the end of the time the coil is ignored after each kick until the next
+ *   pass, and throughout SETTLING, so it flickers or goes out until the Bendulum object is RUNNING.
+ *
+ *       const byte segPins[8] = {2, 3, 4, 5, 6, 7, 8, 13};      // Segments a - g and dp
+ *       const byte digitPins[4] = {A1, A2, A3, A4};             // Digits, left to right
+ *       Bendulum myBendulum;
+ *       BendulumDisplay display;
+ *       void setup() {
+ *           display.begin(segPins, digitPins, 4, HIGH, LOW);    // Common cathode: segments on high, digits low
+ *           display.setTime(12, 0, 0);
+ *           myBendulum.setWatch(BendulumDisplay::watch);
+ *       }
+ *       void loop() {
+ *           long beatDur = myBendulum.beat();
+ *           display.addBeat(beatDur, myBendulum.getPassTime());
+ *       }
+ *
+ *   The segment pins may be on at most DISPLAYPORTS different I/O ports. begin() takes Timer2 over from the Arduino
+ *   core, so tone() and analogWrite() on the pins it drives (3 and 11 on an Uno, 9 and 10 on a Mega) can't be used
+ *   alongside. Only one BendulumDisplay object can be in use, and only on AVR processors. Its interrupt handler is
+ *   defined in this header, so only a sketch that includes it gets it and gives up Timer2 (see BendulumTimer.h).
+ *
+ ****/
+
+#ifndef BendulumDisplay_H
+#define BendulumDisplay_H
+
+#ifdef __AVR__
+
+#if ARDUINO >= 100
+  #include <Arduino.h>  // Arduino 1.0
+#else
+  #include <WProgram.h> // Arduino 0022
+#endif
+
+#define DISPLAYMAX		(6)						// Max number of digits
+#define DISPLAYPORTS	(3)						// Max number of I/O ports the segment pins may be on
+#define DISPLAYTICK		(1000)					// Time (μs) each digit is lit; 16 to 16384000 / (F_CPU / 1000)
+#define DISPLAYDP		(7)						// Segment number of the decimal point
+
+class BendulumDisplay {
+private:
+	byte digits;							// Number of digits
+	byte ports;								// Number of I/O ports the segment pins are on
+	volatile uint8_t *segPort[DISPLAYPORTS];	// The I/O ports the segment pins are on
+	byte segMask[DISPLAYPORTS];				// The segment pins' bits in each
+	byte segPortNo[8];						// For each segment, the index in segPort of its pin's port
+	byte segBit[8];							// For each segment, its pin's bit
+	byte segOn;								// HIGH or LOW: what lights a segment
+	volatile uint8_t *digitPort[DISPLAYMAX];	// The I/O port each digit pin is on
+	byte digitBit[DISPLAYMAX];				// The digit pin's bit in it
+	boolean digitHigh;						// Whether a digit is lit by taking its pin high
+	byte frame[2][DISPLAYMAX][DISPLAYPORTS];	// Two frames: for each digit, what to write to the segment pins' ports
+	long second;							// Time of day (s since midnight) as of the last pass
+	long micro;								// Plus this many μs
+	long frontSecond;						// The second frame front shows; -1 if none
+	long backSecond;						// The second the other frame shows
+	boolean started;						// Whether there's been a beat
+	boolean timeSet;						// Whether setTime() has been invoked
+	unsigned long lastPass;					// Clock time (μs) of the last pass, or of setTime() before the first
+	unsigned long suspendedAt;				// Clock time (μs) at which the display was last suspended
+	boolean suspended;						// Whether the display is suspended
+	volatile byte front;					// The frame being shown
+	volatile byte digit;					// The digit lit
+	volatile unsigned int countdown;		// Number of ticks until the other frame is shown; 0 if never
+	volatile boolean flipped;				// Whether the other frame has been switched to since addBeat()
+
+	void render(byte f, long s);			// Work out frame f to show second s
+	void update();							// Show the current second and have the next shown when it starts
+	void suspend(boolean watching);			// Suspend or resume the display
+
+public:
+	BendulumDisplay();						// Instantiate a BendulumDisplay object
+	boolean begin(const byte *segPins, const byte *digitPins, byte nDigits, byte segLevel, byte digitLevel);
+											// Set up the pins and start Timer2; false if the pins won't do
+	void setTime(byte hour, byte minute, byte sec);
+											// Set the time of day to hour:minute:sec now
+	long getTime();							// Get the time of day (s since midnight) as of the last pass
+	void addBeat(long beatDur, unsigned long passTime);
+											// Add a beat of beatDur μs that ended at clock time passTime (μs)
+	static void watch(boolean watching);	// Tell the display whether the coil is being watched (for setWatch())
+	void refresh();							// Handle Timer2's compare A interrupt (used internally)
+	static BendulumDisplay *active;			// The BendulumDisplay object in use, if any (used internally)
+};
+
+#ifndef BENDULUM_NO_ISR
+// Timer2's compare unit A has matched: time to light the next digit (see BendulumTimer.h for why it's here)
+ISR(TIMER2_COMPA_vect) {
+	if (BendulumDisplay::active != NULL) {
+		BendulumDisplay::active->refresh();
+	}
+}
+#endif
+
+#endif
+
+#endif
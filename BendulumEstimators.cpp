@@ -0,0 +1,427 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumEstimators.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See BendulumEstimators.h for a description of the estimators and the methods they all have.
+ *
+ ****/
+
+#include "BendulumEstimators.h"
+
+/*
+ *
+ * RunningMean
+ *
+ */
+RunningMean::RunningMean() {
+	reset();
+}
+
+// Move avg, which has AVGSHIFT bits of fraction, 1/n of the way to value. The step is rounded to the nearest, halves
+// away from zero, so that, unlike truncation, which always rounds toward zero, it doesn't favour either direction
+void RunningMean::update(long long &avg, int32_t value, int32_t n) {
+	long long step = (long long)value * (1LL << AVGSHIFT) - avg;	// The whole way to value
+
+	avg += (step >= 0 ? step + n / 2 : step - n / 2) / n;
+}
+
+// Forget everything and start over
+void RunningMean::reset() {
+	tickAvg = tockAvg = 0;
+	tickPeriod = 0;
+	var = 0;
+	n = 1;
+	cycles = 0;
+}
+
+// Add a tick or a tock. The averages are exact averages until there are window cycles in them and exponentially
+// smoothed averages over the last window cycles after that.
+void RunningMean::add(boolean tick, int32_t period, int32_t window) {
+	float dev;									// Deviation of this cycle from the estimate (μs)
+
+	if (tick) {									// If tick
+		tickPeriod = period;					//   Remember tick period and update tick average
+		update(tickAvg, period, n);
+		return;
+	}
+	if (n > 1) {								// Else (tock) update the variance of a cycle's duration
+		dev = tickPeriod + period - (float)(tickAvg + tockAvg) / (1LL << AVGSHIFT);
+		var += (dev * dev - var) / n;
+	}											//   and the tock average
+	update(tockAvg, period, n);
+	cycles++;
+	if (n < window) {
+		n++;
+	}
+}
+
+// A rejected beat makes no difference to running averages
+void RunningMean::skip() {
+}
+
+int32_t RunningMean::getTickAvg() {
+	return (tickAvg + (1LL << (AVGSHIFT - 1))) >> AVGSHIFT;
+}
+int32_t RunningMean::getTockAvg() {
+	return (tockAvg + (1LL << (AVGSHIFT - 1))) >> AVGSHIFT;
+}
+int32_t RunningMean::getCycleFine() {
+	const long long unit = (1LL << AVGSHIFT) / FINESCALE;	// 1/FINESCALE μs in fixed point
+
+	if (cycles == 0) {
+		return 0;
+	}
+	return (tickAvg + tockAvg + unit / 2) / unit;
+}
+
+// The variance of the average is the variance of a cycle over the number of cycles averaged
+float RunningMean::getVar() {
+	return n > MINPROMOTE ? var / n : -1;
+}
+
+int32_t RunningMean::getCycles() {
+	return cycles;
+}
+
+// A calibration is over once it has averaged window cycles
+boolean RunningMean::isConverged(int32_t window) {
+	return cycles >= window;
+}
+
+/*
+ *
+ * LeastSquares
+ *
+ */
+LeastSquares::LeastSquares() {
+	reset();
+}
+
+// Forget everything and start over
+void LeastSquares::reset() {
+	base = 0;
+	poolXX = poolXY = 0;
+	cXX = cXY = 0;
+	sumD = sumD2 = sumDD = 0;
+	pairs = 0;
+	meanDiff = 0;
+	cycles = 0;
+	skip();
+}
+
+// A tick or tock was rejected. Close the current stretch and start a new one. Each stretch starts with the point
+// (0, 0): the pass that started its first cycle. That's the pass at the end of the next tock, unless it was the
+// tock that was rejected, in which case it's the pass that ended it.
+void LeastSquares::skip() {
+	poolXX += cXX;
+	poolXY += cXY;
+	cXX = cXY = 0;
+	x = 0;
+	y = 0;
+	meanX = meanY = 0;
+	tickPeriod = 0;
+	hasTick = false;
+	lastD = 0;
+}
+
+// Add a tick or a tock. Each tock ends a cycle and adds a point, (cycle number, time), to the fit. To keep the
+// numbers small enough for float, the time is kept less base times the cycle number, and the sums are updated
+// incrementally as deviations from the means.
+void LeastSquares::add(boolean tick, int32_t period, int32_t window) {
+	int32_t cycle;								// Duration of the cycle just ended (μs)
+	int32_t lastTick;							// Duration of the tick that started it (μs)
+	float d;									// Its difference from base (μs)
+	float dx, dy;								// Deviation of the new point from the old means
+	int32_t n;									// Number of points in the fit
+
+	if (tick) {									// If tick, just remember it. (A flag says there is one, rather
+		tickPeriod = period;					//   than a non-zero tickPeriod, since zero is a perfectly good
+		hasTick = true;							//   value for some things averaged)
+		return;
+	}
+	if (!hasTick) {								// If there's no tick to go with this tock, this is where the
+		return;									//   current stretch starts
+	}
+	if (cycles >= window) {						// Start a fresh fit every window cycles. reset() forgets the
+		lastTick = tickPeriod;					//   tick, so hang on to it
+		reset();
+		tickPeriod = lastTick;
+		hasTick = true;
+	}
+	cycle = tickPeriod + period;
+	if (cycles == 0) {
+		base = cycle;
+	}
+	cycles++;
+	x++;
+	n = x + 1;
+	d = cycle - base;
+	y += d;
+	dx = x - meanX;
+	meanX += dx / n;
+	dy = y - meanY;
+	meanY += dy / n;
+	cXX += dx * (x - meanX);
+	cXY += dx * (y - meanY);
+	sumD += d;									// Keep track of how the cycles vary for getVar()
+	sumD2 += d * d;
+	if (x > 1) {
+		sumDD += d * lastD;
+		pairs++;
+	}
+	lastD = d;
+	meanDiff += ((tickPeriod - period) - meanDiff) / cycles;
+}
+
+// The cycle duration is base plus the slope of the fit, pooled over all the stretches; ticks are longer than half
+// of that by half of meanDiff and tocks shorter. Before the first cycle ends, there's only the tick to go on.
+int32_t LeastSquares::getTickAvg() {
+	if (cycles == 0) {
+		return tickPeriod;
+	}
+	return round((base + (poolXY + cXY) / (poolXX + cXX) + meanDiff) / 2);
+}
+int32_t LeastSquares::getTockAvg() {
+	if (cycles == 0) {
+		return 0;
+	}
+	return round((base + (poolXY + cXY) / (poolXX + cXX) - meanDiff) / 2);
+}
+int32_t LeastSquares::getCycleFine() {
+	if (cycles == 0) {
+		return 0;
+	}
+	return base * FINESCALE + round((poolXY + cXY) / (poolXX + cXX) * FINESCALE);
+}
+
+// The cycles vary for two reasons: errors in timing the passes, r μs² for each pass, which make successive cycles
+// vary in opposite directions, and variations in the bendulum's swing, q μs² for each cycle, which don't. The
+// variance of a cycle is q + 2r and the covariance of successive cycles is -r, so both can be worked out from the
+// cycles seen. The variance of the slope of the fit over n cycles is then about 1.2q/n + 12r/n³.
+float LeastSquares::getVar() {
+	float mean;									// Mean cycle duration less base (μs)
+	float q, r;									// Variance due to the swing and to timing errors (μs²)
+
+	if (cycles < MINPROMOTE) {
+		return -1;
+	}
+	mean = sumD / cycles;
+	r = pairs > 0 ? mean * mean - sumDD / pairs : 0;
+	if (r < 0) {
+		r = 0;
+	}
+	q = sumD2 / cycles - mean * mean - 2 * r;
+	if (q < 0) {
+		q = 0;
+	}
+	return 1.2 * q / cycles + 12 * r / ((float)cycles * cycles * cycles);
+}
+
+int32_t LeastSquares::getCycles() {
+	return cycles;
+}
+
+// A calibration is over once the fit is good enough or it has gone on for window cycles
+boolean LeastSquares::isConverged(int32_t window) {
+	return cycles >= window || (cycles >= MINPROMOTE && getVar() < LSQTARGET * LSQTARGET);
+}
+
+/*
+ *
+ * RobustMean
+ *
+ */
+RobustMean::RobustMean() {
+	reset();
+}
+
+// Forget everything and start over
+void RobustMean::reset() {
+	tickAvg = tockAvg = 0;
+	tickDev = tockDev = 0;
+	tickPeriod = 0;
+	var = 0;
+	n = 1;
+	cycles = 0;
+}
+
+// Cut period back to within ROBUSTK times dev of avg, once there's enough to go on to know what dev is, and update
+// dev, the mean absolute deviation, with what's left. Updating it with what's left, not the whole deviation, keeps an
+// odd wild beat from making the next ones look tame, while a real change in the beat still gets through: dev grows
+// by a factor of up to ROBUSTK each time the beats keep on being cut back.
+int32_t RobustMean::cutBack(long long avg, float &dev, int32_t period) {
+	int32_t mean = (avg + (1LL << (AVGSHIFT - 1))) >> AVGSHIFT;	// avg in μs
+	int32_t limit = ceil(ROBUSTK * dev);		// Furthest a beat may be from mean (μs)
+
+	if (n == 1) {								// If first beat, it is the average; there's no deviation yet
+		return period;
+	}
+	if (n > MINPROMOTE) {
+		period = constrain(period, mean - limit, mean + limit);
+	}
+	dev += (abs(period - mean) - dev) / n;
+	return period;
+}
+
+// Add a tick or a tock, cut back if need be. The rest is just as for RunningMean.
+void RobustMean::add(boolean tick, int32_t period, int32_t window) {
+	float dev;									// Deviation of this cycle from the estimate (μs)
+
+	if (tick) {									// If tick, remember the tick period and update the tick average
+		tickPeriod = cutBack(tickAvg, tickDev, period);
+		RunningMean::update(tickAvg, tickPeriod, n);
+		return;
+	}
+	period = cutBack(tockAvg, tockDev, period);
+	if (n > 1) {								// Else (tock) update the variance of a cycle's duration
+		dev = tickPeriod + period - (float)(tickAvg + tockAvg) / (1LL << AVGSHIFT);
+		var += (dev * dev - var) / n;
+	}											//   and the tock average
+	RunningMean::update(tockAvg, period, n);
+	cycles++;
+	if (n < window) {
+		n++;
+	}
+}
+
+// A rejected beat makes no difference to running averages
+void RobustMean::skip() {
+}
+
+int32_t RobustMean::getTickAvg() {
+	return (tickAvg + (1LL << (AVGSHIFT - 1))) >> AVGSHIFT;
+}
+int32_t RobustMean::getTockAvg() {
+	return (tockAvg + (1LL << (AVGSHIFT - 1))) >> AVGSHIFT;
+}
+int32_t RobustMean::getCycleFine() {
+	const long long unit = (1LL << AVGSHIFT) / FINESCALE;	// 1/FINESCALE μs in fixed point
+
+	if (cycles == 0) {
+		return 0;
+	}
+	return (tickAvg + tockAvg + unit / 2) / unit;
+}
+
+// The variance of the average is the variance of a (cut back) cycle over the number of cycles averaged
+float RobustMean::getVar() {
+	return n > MINPROMOTE ? var / n : -1;
+}
+
+int32_t RobustMean::getCycles() {
+	return cycles;
+}
+
+// A calibration is over once it has averaged window cycles
+boolean RobustMean::isConverged(int32_t window) {
+	return cycles >= window;
+}
+
+/*
+ *
+ * KalmanFilter
+ *
+ */
+KalmanFilter::KalmanFilter() {
+	reset();
+}
+
+// Forget everything and start over
+void KalmanFilter::reset() {
+	base = 0;
+	est = p = r = 0;
+	meanDiff = 0;
+	cycles = 0;
+	skip();
+}
+
+// A rejected tick leaves the tock after it without a cycle; otherwise a gap makes no difference
+void KalmanFilter::skip() {
+	tickPeriod = 0;
+	hasTick = false;
+}
+
+// Add a tick or a tock. Each tock ends a cycle, which updates the estimate. For the first MINPROMOTE cycles, there's
+// not enough to go on to know how noisy the cycles are, so the estimate is their plain average, and r their
+// variance. After that, each cycle is a Kalman filter step: the estimate's variance grows by the wander, r over
+// window², and the cycle moves the estimate toward it by the gain, p over p + r, which shrinks p. That wander makes
+// the gain settle at about 1/window. r keeps being learned from how far the cycles are from the estimate.
+void KalmanFilter::add(boolean tick, int32_t period, int32_t window) {
+	float d;									// Duration of the cycle just ended, less base (μs)
+	float innov;								// Its difference from the estimate (μs)
+	float gain;									// Fraction of the way to move the estimate toward it
+	int32_t n;									// Number of cycles r is learned over
+
+	if (tick) {									// If tick, just remember it
+		tickPeriod = period;
+		hasTick = true;
+		return;
+	}
+	if (!hasTick) {								// If there's no tick to go with this tock, there's no cycle
+		return;
+	}
+	hasTick = false;
+	if (cycles == 0) {
+		base = tickPeriod + period;
+	}
+	cycles++;
+	d = tickPeriod + period - base;
+	innov = d - est;
+	meanDiff += ((tickPeriod - period) - meanDiff) / (cycles < window ? cycles : window);
+	if (cycles <= MINPROMOTE) {					// Early on, a plain average and variance
+		est += innov / cycles;
+		if (cycles > 1) {
+			r += (innov * (d - est) - r) / (cycles - 1);
+		}
+		p = r / cycles;
+		return;
+	}
+	n = cycles < window ? cycles : window;
+	p += r / ((float)window * window);			// The cycle duration may have wandered since the last cycle
+	r += (innov * innov - p - r) / n;			// An innovation's variance is p + r
+	if (r < 0) {
+		r = 0;
+	}
+	gain = p + r > 0 ? p / (p + r) : 1.0 / n;
+	est += gain * innov;
+	p *= 1 - gain;
+}
+
+// The cycle duration is base plus the estimate; ticks are longer than half of that by half of meanDiff and tocks
+// shorter. Before the first cycle ends, there's only the tick to go on.
+int32_t KalmanFilter::getTickAvg() {
+	if (cycles == 0) {
+		return tickPeriod;
+	}
+	return round((base + est + meanDiff) / 2);
+}
+int32_t KalmanFilter::getTockAvg() {
+	if (cycles == 0) {
+		return 0;
+	}
+	return round((base + est - meanDiff) / 2);
+}
+int32_t KalmanFilter::getCycleFine() {
+	if (cycles == 0) {
+		return 0;
+	}
+	return base * FINESCALE + round(est * FINESCALE);
+}
+
+// The variance of the estimate is p, once there's enough to go on to know it
+float KalmanFilter::getVar() {
+	return cycles >= MINPROMOTE ? p : -1;
+}
+
+int32_t KalmanFilter::getCycles() {
+	return cycles;
+}
+
+// A calibration is over once the estimate is good enough or it has gone on for window cycles
+boolean KalmanFilter::isConverged(int32_t window) {
+	return cycles >= window || (cycles >= MINPROMOTE && p < KALTARGET * KALTARGET);
+}
@@ -0,0 +1,196 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumEstimators.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   The calibration estimators a Bendulum object can use to work out the average durations of ticks and tocks from
+ *   the beats it measures in CALIBRATING and RUNNING modes. The estimator is chosen when the Bendulum object is
+ *   declared, as a template parameter, so there is no cost for choosing at run time:
+ *
+ *       Bendulum myBendulum;                          // Uses RunningMean
+ *       BasicBendulum<LeastSquares> myBendulum;       // Uses LeastSquares
+ *       BasicBendulum<RobustMean> myBendulum;         // Uses RobustMean
+ *       BasicBendulum<KalmanFilter> myBendulum;       // Uses KalmanFilter
+ *
+ *   Every estimator has the same methods, and any class that has them can be used as one, e.g.
+ *   BasicBendulum<MyEstimator>, without changing the library:
+ *
+ *       void reset()                                  Forget everything and start over
+ *       void add(boolean tick, int32_t period, int32_t window)
+ *                                                     Add the duration (μs) of a tick or a tock. A cycle is a tick
+ *                                                     followed by a tock. window is the number of cycles,
+ *                                                     getTgtSmoothing(), that the estimate should span
+ *       void skip()                                   Note that a tick or tock was rejected as an outlier
+ *       int32_t getTickAvg()                          Get the estimated average duration (μs) of ticks
+ *       int32_t getTockAvg()                          Get the estimated average duration (μs) of tocks
+ *       int32_t getCycleFine()                        Get the estimated average duration of a cycle in 1/FINESCALE
+ *                                                     μs, or 0 if there's no tock yet
+ *       float getVar()                                Get the variance (μs²) of the estimated duration of a cycle,
+ *                                                     or -1 if there's not enough to go on yet
+ *       int32_t getCycles()                           Get the number of cycles added since reset()
+ *       boolean isConverged(int32_t window)           True once a calibration can end
+ *
+ *   RunningMean, the original, keeps running averages of the tick and tock durations over window cycles. It needs the
+ *   least RAM and CPU and calibrates in exactly window cycles. The averages are kept in 64-bit fixed point, with
+ *   AVGSHIFT bits of fraction, and each update is rounded to the nearest, so even over a window of a million cycles
+ *   an update never rounds away to nothing and the rounding doesn't pull the averages one way or the other.
+ *
+ *   LeastSquares fits a straight line to the times at which successive cycles end; its slope is the cycle duration. A
+ *   running average of the cycle durations comes to the time between the first and last passes divided by the number
+ *   of cycles, so an error in detecting either of those two passes goes straight into it. The fit uses every pass,
+ *   which makes it much less sensitive to errors in detecting passes, though no better when it's the bendulum's swing
+ *   itself that varies. Its uncertainty allows for both: errors in detecting a pass make successive cycles err in
+ *   opposite directions, while variations in the swing don't, so the two can be told apart from how much the cycles
+ *   vary and how much successive ones vary together. A rejected beat leaves a gap in the times, so the fit is made to
+ *   the stretches between gaps, all with the same slope. It is converged once the standard error of its estimate of
+ *   the cycle duration is below LSQTARGET μs (but not before MINPROMOTE cycles), or after window cycles, whichever is
+ *   first. It needs a little more RAM and, since it uses floating point, a good deal more CPU. In RUNNING mode it
+ *   starts a fresh fit every window cycles.
+ *
+ *   RobustMean is RunningMean with the beats that are far off the average cut back before they go into it. The
+ *   outlier filter only rejects beats that are grossly wrong; a beat that's off by a few times the usual amount, from
+ *   a pass detected late or a draught, still goes in, and a running average gives it its full weight. RobustMean
+ *   keeps track of how far, on average, ticks and tocks are from their averages, and once it has MINPROMOTE cycles to
+ *   go on, it moves a beat that's more than ROBUSTK times that from its average to ROBUSTK times that before adding
+ *   it (a Huber estimator). It needs a few bytes more RAM than RunningMean and a little more CPU, and, like it,
+ *   calibrates in window cycles.
+ *
+ *   KalmanFilter treats the cycle duration as something that wanders a little from cycle to cycle, as it does with
+ *   temperature, and each cycle measured as that plus noise. It keeps an estimate of the cycle duration and of its
+ *   variance; each cycle moves the estimate toward the cycle by as much as their variances say it should. The noise
+ *   is learned from how far the cycles are from the estimate, and the wander is set so that, in the long run, the
+ *   estimate spans about window cycles, like the running averages. Early on, when the estimate is poor, each cycle
+ *   counts for more, so it is converged once the standard error of its estimate is below KALTARGET μs (but not before
+ *   MINPROMOTE cycles), or after window cycles, whichever is first. In RUNNING mode it keeps going without starting
+ *   over, following the beat as it changes. It needs less RAM and CPU than LeastSquares.
+ *
+ ****/
+
+#ifndef BendulumEstimators_H
+#define BendulumEstimators_H
+
+#if ARDUINO >= 100
+  #include <Arduino.h>  // Arduino 1.0
+#else
+  #include <WProgram.h> // Arduino 0022
+#endif
+
+#define MINPROMOTE	(16)						// Min cycles in the shadow estimate before its variance is trusted
+#define LSQTARGET	(2)							// Standard error (μs) of the cycle duration at which LeastSquares is
+												//   converged
+#define FINESCALE	(256)						// Number of parts a μs is divided into by getCycleFine()
+#define AVGSHIFT	(32)						// Number of fraction bits in RunningMean's fixed point averages
+#define ROBUSTK		(2)							// Number of mean absolute deviations from its average beyond which
+												//   RobustMean cuts a beat back
+#define KALTARGET	(2)							// Standard error (μs) of the cycle duration at which KalmanFilter is
+												//   converged
+
+class RunningMean {
+private:
+	long long tickAvg;						// Average duration of ticks (μs, with AVGSHIFT fraction bits)
+	long long tockAvg;						// Average duration of tocks (μs, with AVGSHIFT fraction bits)
+	int32_t tickPeriod;						// Duration of the last tick (μs)
+	float var;								// Variance of the duration of a cycle (μs²)
+	int32_t n;								// Number of cycles being averaged over (at most window)
+	int32_t cycles;							// Number of cycles added since reset()
+
+public:
+	RunningMean();
+	static void update(long long &avg, int32_t value, int32_t n);
+											// Move avg, with AVGSHIFT fraction bits, 1/n of the way to value
+	void reset();
+	void add(boolean tick, int32_t period, int32_t window);
+	void skip();
+	int32_t getTickAvg();
+	int32_t getTockAvg();
+	int32_t getCycleFine();
+	float getVar();
+	int32_t getCycles();
+	boolean isConverged(int32_t window);
+};
+
+class LeastSquares {
+private:
+	int32_t base;							// Duration of the first cycle (μs); the fit is to the difference from it
+	float y;								// Time at which the last cycle ended, less base times the cycle number,
+											//   both counted from the start of the current stretch between gaps
+	int32_t x;								// Number of cycles in the current stretch
+	float meanX, meanY;						// Mean cycle number and mean y in the current stretch
+	float cXX, cXY;							// Sums of products of deviations from the means in the current stretch
+	float poolXX, poolXY;					// Sums of cXX and cXY for the stretches before the current one
+	float lastD;							// Duration of the last cycle, less base (μs)
+	float sumD, sumD2, sumDD;				// Sums of the cycle durations less base, their squares and the products
+											//   of successive ones
+	int32_t pairs;							// Number of products in sumDD
+	float meanDiff;							// Average amount (μs) by which ticks are longer than tocks
+	int32_t tickPeriod;						// Duration of the last tick (μs)
+	boolean hasTick;						// Whether there's a tick to go with the next tock
+	int32_t cycles;							// Number of cycles added since reset()
+
+public:
+	LeastSquares();
+	void reset();
+	void add(boolean tick, int32_t period, int32_t window);
+	void skip();
+	int32_t getTickAvg();
+	int32_t getTockAvg();
+	int32_t getCycleFine();
+	float getVar();
+	int32_t getCycles();
+	boolean isConverged(int32_t window);
+};
+
+class RobustMean {
+private:
+	long long tickAvg;						// Average duration of ticks (μs, with AVGSHIFT fraction bits)
+	long long tockAvg;						// Average duration of tocks (μs, with AVGSHIFT fraction bits)
+	float tickDev;							// Mean absolute deviation (μs) of ticks from tickAvg
+	float tockDev;							// Mean absolute deviation (μs) of tocks from tockAvg
+	int32_t tickPeriod;						// Duration of the last tick, as cut back (μs)
+	float var;								// Variance of the duration of a cycle (μs²)
+	int32_t n;								// Number of cycles being averaged over (at most window)
+	int32_t cycles;							// Number of cycles added since reset()
+
+	int32_t cutBack(long long avg, float &dev, int32_t period);
+											// Cut period back to within ROBUSTK times dev of avg
+public:
+	RobustMean();
+	void reset();
+	void add(boolean tick, int32_t period, int32_t window);
+	void skip();
+	int32_t getTickAvg();
+	int32_t getTockAvg();
+	int32_t getCycleFine();
+	float getVar();
+	int32_t getCycles();
+	boolean isConverged(int32_t window);
+};
+
+class KalmanFilter {
+private:
+	int32_t base;							// Duration of the first cycle (μs); the estimate is the difference
+	float est;								// Estimated cycle duration, less base (μs)
+	float p;								// Variance of est (μs²)
+	float r;								// Variance of a cycle about the true cycle duration (μs²)
+	float meanDiff;							// Average amount (μs) by which ticks are longer than tocks
+	int32_t tickPeriod;						// Duration of the last tick (μs)
+	boolean hasTick;						// Whether there's a tick to go with the next tock
+	int32_t cycles;							// Number of cycles added since reset()
+
+public:
+	KalmanFilter();
+	void reset();
+	void add(boolean tick, int32_t period, int32_t window);
+	void skip();
+	int32_t getTickAvg();
+	int32_t getTockAvg();
+	int32_t getCycleFine();
+	float getVar();
+	int32_t getCycles();
+	boolean isConverged(int32_t window);
+};
+
+#endif
@@ -0,0 +1,191 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumFit.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See BendulumFit.h for a description of what a BendulumFit object does and how to use it.
+ *
+ ****/
+
+#include "BendulumFit.h"
+
+#ifndef __AVR__
+
+/*
+ *
+ * Constructor
+ *
+ */
+// Instantiate a BendulumFit object. It does nothing until begin() is invoked.
+BendulumFit::BendulumFit() {
+	period = 0;								// Not started
+	lastPeriod = 0;							// No estimate yet
+	fresh = false;
+	winOpen = false;
+	samples = 0;
+	windows = 0;
+}
+
+/*
+ *
+ * Public methods
+ *
+ */
+
+// Start estimating from a first guess at the cycle duration in μs. The guess needs to be within about half a
+// frequency bin (a fraction 1/(2*FITCYCLES)) of the truth; a calibrated tickAvg + tockAvg is far better than that.
+void BendulumFit::begin(double cyclePeriod) {
+	period = cyclePeriod;
+	winOpen = false;						// The first reading opens the first window
+	windows = 0;
+}
+
+// Accumulate the coil reading value, taken at clock time t (μs), into the Fourier sums for the current window
+void BendulumFit::addSample(uint32_t t, int value) {
+	double hc, hs, tmp;							// Cosine and sine of the phase of the current harmonic
+	double weight;								// The reading, tapered toward the ends of the window
+
+	if (period <= 0) {							// Nothing to do until started
+		return;
+	}
+	if (!winOpen) {
+		openWindow(t);
+	} else if (t - winStart >= FITCYCLES * period) {
+		closeWindow();							// If the window's over, finish it and start the next one
+		openWindow(t);
+	}
+	if (value == 0) {							// A zero reading adds nothing to the sums
+		return;
+	}
+	turn(t - lastT);							// Bring the phases up to t
+	lastT = t;
+	samples++;
+	weight = value * (1 - phC[FITTRIALS]);
+	for (byte m = 0; m < FITTRIALS; m++) {		// For each trial frequency
+		hc = phC[m];
+		hs = phS[m];
+		for (byte k = 0; k < FITHARMONICS; k++) {
+			re[m][k] += weight * hc;				//   Add the reading to the sum for each harmonic, getting each
+			im[m][k] -= weight * hs;				//   harmonic's phase by rotating the last one by the fundamental's
+			tmp = hc * phC[m] - hs * phS[m];
+			hs = hs * phC[m] + hc * phS[m];
+			hc = tmp;
+		}
+	}
+}
+
+// True if a window has finished since the last time this returned true
+boolean BendulumFit::available() {
+	boolean answer = fresh;
+	fresh = false;
+	return answer;
+}
+
+// Get the cycle duration, in μs, estimated from the last window finished (0 if none has been)
+double BendulumFit::getPeriod() {
+	return lastPeriod;
+}
+
+// Get the number of windows finished since begin(). Unlike available(), this doesn't change what a sketch sees.
+int32_t BendulumFit::getWindows() {
+	return windows;
+}
+
+// True once begin() has been invoked
+boolean BendulumFit::isStarted() {
+	return period > 0;
+}
+
+/*
+ *
+ * Private methods
+ *
+ */
+
+// Start a new window at clock time t, with the trial frequencies centred on the current estimate and half a
+// frequency bin apart. (A bin is one over the length of the window.)
+void BendulumFit::openWindow(uint32_t t) {
+	double step = 0.5 / (FITCYCLES * period);	// Spacing (cycles/μs) of the trial frequencies
+
+	winStart = t;
+	winOpen = true;
+	samples = 0;
+	for (byte m = 0; m < FITTRIALS; m++) {
+		freq[m] = 1.0 / period + (m - (FITTRIALS - 1) / 2) * step;
+		for (byte k = 0; k < FITHARMONICS; k++) {
+			re[m][k] = im[m][k] = 0;
+		}
+	}
+	lastT = t;									// All the phases are zero at the start of the window, and a zero
+	stepT = 0;									//   time between readings turns them by nothing
+	for (byte m = 0; m <= FITTRIALS; m++) {
+		phC[m] = twC[m] = 1;
+		phS[m] = twS[m] = 0;
+	}
+}
+
+// Advance the phases at the trial frequencies, and that of the taper, by dt μs. The twiddle factors for dt are only
+// worked out afresh if dt isn't the same as last time.
+void BendulumFit::turn(uint32_t dt) {
+	double angle;								// Rotation (radians) in dt μs
+	double tmp;
+
+	if (dt != stepT) {
+		for (byte m = 0; m <= FITTRIALS; m++) {
+			angle = TWO_PI * (m < FITTRIALS ? freq[m] : 1.0 / (FITCYCLES * period)) * (double)dt;
+			twC[m] = cos(angle);
+			twS[m] = sin(angle);
+		}
+		stepT = dt;
+	}
+	for (byte m = 0; m <= FITTRIALS; m++) {
+		tmp = phC[m] * twC[m] - phS[m] * twS[m];
+		phS[m] = phS[m] * twC[m] + phC[m] * twS[m];
+		phC[m] = tmp;
+	}
+}
+
+// Finish the current window: find the power of the periodic signal at each trial frequency, fit a parabola through
+// the logarithms of the powers and take its vertex as the fundamental frequency. The peak is close to a Gaussian, so
+// the logarithms are close to a parabola; a parabola through the powers themselves would put the vertex too near the
+// centre, and the estimate would home in only a little each window. If the vertex isn't between the outer trial
+// frequencies, just move the estimate to the strongest of them; the next window will home in from there.
+void BendulumFit::closeWindow() {
+	double power[FITTRIALS];					// Log of the power summed over the harmonics at each trial frequency
+	double a;									// Curvature of the parabola through their logarithms
+	double x;									// Position of its vertex, in trial frequency steps from the centre
+
+	if (samples == 0) {							// If nothing was seen, there's nothing to go on
+		return;
+	}
+	for (byte m = 0; m < FITTRIALS; m++) {
+		power[m] = 0;
+		for (byte k = 0; k < FITHARMONICS; k++) {
+			power[m] += re[m][k] * re[m][k] + im[m][k] * im[m][k];
+		}
+		if (power[m] <= 0) {					// No signal at all at one of them; nothing to go on
+			return;
+		}
+		power[m] = log(power[m]);
+	}
+	a = power[0] - 2 * power[1] + power[2];
+	if (a < 0) {								// The centre is a peak; interpolate
+		x = 0.5 * (power[0] - power[2]) / a;
+		if (x > 1) {
+			x = 1;
+		} else if (x < -1) {
+			x = -1;
+		}
+	} else {									// Not a peak; move toward the stronger side
+		x = power[2] > power[0] ? 1 : -1;
+	}
+	period = 1.0 / (freq[1] + x * (freq[2] - freq[1]));
+	lastPeriod = period;
+	fresh = true;
+	windows++;
+}
+
+#endif
@@ -0,0 +1,94 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumFit.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   A BendulumFit object estimates the duration of a bendulum's cycle from the coil readings themselves rather than
+ *   from the times at which passes are detected. Timing the passes throws away nearly all of what the coil shows;
+ *   the readings taken while watching for a pass carry the whole shape of the pulse the magnet induces, and that
+ *   shape repeats once per cycle.
+ *
+ *   The readings are treated as a periodic signal made up of FITHARMONICS harmonics, counting the fundamental.
+ *   Over a window of FITCYCLES cycles, the Fourier sums of the readings, tapered toward the ends of the window
+ *   so that the window's edges don't leak into them, are accumulated at three trial frequencies: the current
+ *   estimate and half a frequency bin either side of it. The strength of the periodic signal at each is the
+ *   total power over all the harmonics. A parabola through the logarithms of the three gives the frequency at
+ *   which the signal is strongest, and the cycle duration is one over that. Each window's result is reported and
+ *   becomes the centre of the next window, so the estimate tracks the bendulum. The readings need not be evenly
+ *   spaced -- there are gaps while the coil is ignored after each kick -- since each is used at the time it was
+ *   taken.
+ *
+ *   The sums need double precision floating point, so a BendulumFit object is only available on processors that
+ *   aren't AVRs (e.g. the ARM-based boards). The phase at each trial frequency, and that of the taper, is carried
+ *   from reading to reading by multiplying by a precomputed rotation, a twiddle factor, for the time between them.
+ *   The readings come at a steady pace while the coil is being watched, so the twiddle factors only need working
+ *   out again, with sin() and cos(), when that time changes, e.g. after the gap that follows a kick.
+ *
+ *   Attach a BendulumFit object to a Bendulum object with Bendulum::setFit(). The Bendulum object passes it every
+ *   reading it takes while watching for passes (as zero if it's below peakScale, since that's just noise) and
+ *   starts it off with the first cycle it measures, so it has homed in on the bendulum by the time CALIBRATING
+ *   begins. While CALIBRATING, the Bendulum object averages its estimates and uses the average as its live estimate
+ *   whenever that's the better one, ending CALIBRATING once the average's standard error is below FITTARGET μs.
+ *   A sketch can also check available() from time to time; when it returns true, getPeriod() is the estimate from
+ *   the window just finished. The durations are as measured by the Arduino clock; they are not corrected for its
+ *   error.
+ *
+ ****/
+
+#ifndef BendulumFit_H
+#define BendulumFit_H
+
+#ifndef __AVR__
+
+#if ARDUINO >= 100
+  #include <Arduino.h>  // Arduino 1.0
+#else
+  #include <WProgram.h> // Arduino 0022
+#endif
+
+#define FITHARMONICS	(4)						// Number of harmonics (including the fundamental) fitted
+#define FITCYCLES		(16)					// Number of cycles in each window the period is estimated over
+#define FITTRIALS		(3)						// Number of trial frequencies per window
+#define FITMIN			(8)						// Min windows averaged before the average is used when CALIBRATING
+#define FITTARGET		(2)						// Standard error (μs) of the average at which CALIBRATING can end
+
+class BendulumFit {
+private:
+	double period;							// Current estimate of the cycle duration (μs); 0 if not started
+	double lastPeriod;						// Estimate from the last window finished (μs)
+	boolean fresh;							// Whether lastPeriod hasn't been reported by available() yet
+	uint32_t winStart;						// Clock time (μs) at the start of the current window
+	boolean winOpen;						// Whether a window has been started
+	double freq[FITTRIALS];					// Trial frequencies (cycles/μs) for the current window
+	double re[FITTRIALS][FITHARMONICS];		// Real parts of the Fourier sums
+	double im[FITTRIALS][FITHARMONICS];		// Imaginary parts of the Fourier sums
+	unsigned int samples;					// Number of readings in the current window
+	int32_t windows;						// Number of windows finished since begin()
+	uint32_t lastT;							// Clock time (μs) of the last reading summed (or of the window's start)
+	uint32_t stepT;							// Time (μs) between readings that the twiddle factors are for
+	double phC[FITTRIALS + 1];				// Cosine and sine of the phase at lastT at each trial frequency, and,
+	double phS[FITTRIALS + 1];				//   last, of the taper's
+	double twC[FITTRIALS + 1];				// Cosine and sine of the rotation in stepT μs of each of them
+	double twS[FITTRIALS + 1];
+
+	void openWindow(uint32_t t);			// Start a new window at clock time t
+	void turn(uint32_t dt);					// Advance the phases by dt μs
+	void closeWindow();						// Finish the current window and update the estimate
+
+public:
+	BendulumFit();							// Instantiate a BendulumFit object
+	void begin(double cyclePeriod);			// Start estimating from a first guess at the cycle duration (μs)
+	void addSample(uint32_t t, int value);
+											// Accumulate the coil reading value taken at clock time t (μs)
+	boolean available();					// True if a window has finished since the last time this returned true
+	double getPeriod();						// Get the cycle duration (μs) from the last window finished
+	int32_t getWindows();					// Get the number of windows finished since begin()
+	boolean isStarted();					// True once begin() has been invoked
+};
+
+#endif
+
+#endif
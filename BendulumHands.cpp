@@ -0,0 +1,263 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumHands.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See BendulumHands.h for a description of what a BendulumHands object does and how to use it.
+ *
+ ****/
+
+#define BENDULUM_NO_ISR							// The handlers are for the sketch (see BendulumTimer.h)
+#include "BendulumHands.h"
+
+#ifdef __AVR__
+
+BendulumHands *BendulumHands::active = NULL;
+
+/*
+ *
+ * Constructor
+ *
+ */
+// Instantiate a BendulumHands object. It does nothing until begin() is invoked.
+BendulumHands::BendulumHands() {
+	state = HANDS_IDLE;
+	stepsPerHour = 3600;
+	cycle = 12 * stepsPerHour;
+	steps = 0;
+	phase = 0;
+	phaseErr = 0;
+	started = false;
+	timeSet = false;
+	lastPass = 0;
+	due = 0;
+	position = 0;
+	boundaryErr = 0;
+	atBoundary = false;
+}
+
+/*
+ *
+ * Public methods
+ *
+ */
+// Set up for a motor that takes perHour steps per hour of the dial, going at most maxRate steps a second, with
+// its driver's direction pin on dirPin, at dirLevel (HIGH or LOW) for clockwise. Start Timer1, make the step pin an
+// output, low, and have compare unit B interrupt. The hands start once the time is set or, failing that, with the
+// first beat.
+void BendulumHands::begin(long perHour, unsigned int maxRate, byte dirPin, byte dirLevel) {
+	stepsPerHour = constrain(perHour, 4, 500000L);
+	cycle = 12 * stepsPerHour;
+	stepUs = 3600000000UL / stepsPerHour;	// Split the duration of a step into whole μs and whole ticks,
+	stepUsFrac = 3600000000UL % stepsPerHour;	//   with the remainders in 1 / stepsPerHour μs and ticks
+	stepTicks = stepUs * TIMERTICKS + stepUsFrac * TIMERTICKS / stepsPerHour;
+	stepTicksFrac = stepUsFrac * TIMERTICKS % stepsPerHour;
+	minInterval = 1000000L * TIMERTICKS / (maxRate > 0 ? maxRate : 1);
+	if (minInterval < 2 * HANDSWIDTH * TIMERTICKS) {
+		minInterval = 2 * HANDSWIDTH * TIMERTICKS;
+	}
+	digitalWrite(dirPin, dirLevel);
+	pinMode(dirPin, OUTPUT);
+	BendulumTimer::begin();
+	digitalWrite(HANDSPIN, LOW);				// When the compare unit lets go of the pin, this is what it shows
+	pinMode(HANDSPIN, OUTPUT);
+	noInterrupts();
+	active = this;
+	lastStep = BendulumTimer::now() - minInterval;
+	TIFR1 = _BV(OCF1B);
+	TIMSK1 |= _BV(OCIE1B);
+	interrupts();
+}
+
+// Say where the hands are: at hour:minute:sec
+void BendulumHands::setHands(byte hour, byte minute, byte sec) {
+	long us;								// Unused
+	long p = toSteps(hour, minute, sec, &us);	// The position
+
+	noInterrupts();
+	position = p;
+	interrupts();
+}
+
+// Set the time of day to hour:minute:sec as of now. If the hands aren't there, they catch up or wait.
+void BendulumHands::setTime(byte hour, byte minute, byte sec) {
+	steps = toSteps(hour, minute, sec, &phase);
+	phaseErr = 0;
+	if (started) {							// Count the bendulum's time from now
+		phase -= micros() - lastPass;
+	} else {								// Or, until the first beat, from the Arduino clock's
+		lastPass = micros();
+	}
+	timeSet = true;
+	resync(BendulumTimer::fromMicros(lastPass), true);
+}
+
+// Add a beat of beatDur μs, as returned by beat(), that ended at clock time passTime, as returned by getPassTime(),
+// and line the steps up with the bendulum's time. Until the first beat, the time runs by the Arduino's clock. If the
+// time was never set, the hands start from where they are with the first beat.
+void BendulumHands::addBeat(long beatDur, unsigned long passTime) {
+	long len;								// Duration (μs) of the current step
+
+	if (started) {
+		phase += beatDur;
+	} else if (timeSet) {
+		phase += passTime - lastPass;
+	} else {
+		noInterrupts();
+		steps = position;
+		interrupts();
+	}
+	started = true;
+	lastPass = passTime;
+	while (true) {							// Count the steps that have started, stepUs or stepUs + 1 μs each
+		len = stepUs + (phaseErr + stepUsFrac >= stepsPerHour ? 1 : 0);
+		if (phase < len) {
+			break;
+		}
+		phase -= len;
+		phaseErr += stepUsFrac;
+		if (phaseErr >= stepsPerHour) {
+			phaseErr -= stepsPerHour;
+		}
+		if (++steps >= cycle) {
+			steps = 0;
+		}
+	}
+	resync(BendulumTimer::fromMicros(passTime), false);
+}
+
+// Get the number of steps the hands are behind the time, or, if they're ahead, minus the number they're ahead
+long BendulumHands::getLag() {
+	long lag;								// Steps behind
+
+	noInterrupts();
+	lag = due - position;
+	interrupts();
+	if (lag < 0) {
+		lag += cycle;
+	}
+	return lag < cycle / 2 ? lag : lag - cycle;
+}
+
+// Handle Timer1's compare B interrupt. The compare unit matches each time Timer1 passes OCR1B, so, even when it
+// isn't set up for a step, this is invoked every 65536 ticks, which is how the steps due are counted and a waiting
+// step is noticed once it comes within range.
+void BendulumHands::handleCompare() {
+	switch (state) {
+		case HANDS_WAITING:					// Waiting: count the steps due and see whether the next is near
+			service();
+			break;
+		case HANDS_ARMED:					// The compare unit has just set the pin: the step has started
+			stepped(stepAt);
+			break;
+		case HANDS_HIGH:					// The compare unit has just cleared the pin: let go of it and set up
+			TCCR1A &= ~(_BV(COM1B1) | _BV(COM1B0));	//   the next step
+			state = HANDS_WAITING;
+			service();
+			break;
+	}
+}
+
+/*
+ *
+ * Private methods
+ *
+ */
+// Convert the time of day hour:minute:sec to the number of steps the hands have taken since 12:00:00 plus, in *us,
+// the number of μs since the last of them
+long BendulumHands::toSteps(byte hour, byte minute, byte sec, long *us) {
+	long s = (hour % 12) * 3600L + minute * 60L + sec;	// Seconds since 12:00:00
+	long part = (s % 3600) * stepsPerHour;	// Steps since the hour, in 1/3600 step
+
+	*us = (unsigned long)(part % 3600) * 1000000UL / stepsPerHour;
+	return s / 3600 * stepsPerHour + part / 3600;
+}
+
+// Line the steps up with the bendulum's time: as of passTicks (ticks), the steps due are steps and the next one is
+// due stepUs - phase μs later. Unless force, leave things be if the compare unit is already set up for that step;
+// it'll be out by no more than the Arduino clock's error over a beat. Then set up the next step.
+void BendulumHands::resync(unsigned long passTicks, boolean force) {
+	long toGo = stepUs + (phaseErr + stepUsFrac >= stepsPerHour ? 1 : 0) - phase;
+											// Time (μs) from passTicks to the next step
+
+	noInterrupts();
+	if (force || state != HANDS_ARMED || !atBoundary) {
+		due = steps;
+		boundary = passTicks + toGo * TIMERTICKS;
+		if (state == HANDS_IDLE) {
+			state = HANDS_WAITING;
+		}
+		if (state == HANDS_WAITING) {
+			service();
+		}
+	}
+	interrupts();
+}
+
+// Count the steps due up to now and, if the step output is waiting, work out when the next step should be: at the
+// next boundary if the hands are where they should be, as soon as minInterval allows if they're behind, and not
+// until the time catches up with them if they're ahead. If that's within range of the compare unit, set it up to
+// start the step pulse then. If it's too near for that, or overdue, start it now. Interrupts must be off.
+void BendulumHands::service() {
+	unsigned long t = BendulumTimer::now();	// Time now (ticks)
+	unsigned long at;						// Time (ticks) of the next step
+	long behind;							// Number of steps the hands are behind
+
+	while ((long)(t - boundary) >= 0) {		// Count the steps due, stepTicks or stepTicks + 1 ticks apart
+		if (++due >= cycle) {
+			due = 0;
+		}
+		boundaryErr += stepTicksFrac;
+		boundary += stepTicks;
+		if (boundaryErr >= stepsPerHour) {
+			boundaryErr -= stepsPerHour;
+			boundary++;
+		}
+	}
+	if (state != HANDS_WAITING) {
+		return;
+	}
+	behind = due - position;
+	if (behind < 0) {
+		behind += cycle;
+	}
+	if (behind == 0) {						// Where they should be: step as due goes up
+		at = boundary;
+		atBoundary = true;
+	} else if (behind < cycle / 2) {		// Behind: catch up
+		at = lastStep + minInterval;
+		if ((long)(at - t) < 0) {
+			at = t;
+		}
+		atBoundary = false;
+	} else {								// Ahead: wait
+		return;
+	}
+	if ((long)(at - t) < HANDSMARGIN) {
+		TCCR1A |= _BV(COM1B1) | _BV(COM1B0);	// Set the pin by forcing a match
+		TCCR1C = _BV(FOC1B);
+		stepped(t);
+	} else if (at - t < 0x10000UL - HANDSMARGIN) {
+		OCR1B = (unsigned int)at;			// Set the pin at the match
+		TCCR1A |= _BV(COM1B1) | _BV(COM1B0);
+		stepAt = at;
+		state = HANDS_ARMED;
+	}
+}
+
+// The step pulse started at time t (ticks). Have the compare unit clear the pin HANDSWIDTH μs later and count the
+// step.
+void BendulumHands::stepped(unsigned long t) {
+	OCR1B = (unsigned int)(t + HANDSWIDTH * TIMERTICKS);
+	TCCR1A = (TCCR1A & ~_BV(COM1B0)) | _BV(COM1B1);
+	state = HANDS_HIGH;
+	lastStep = t;
+	if (++position >= cycle) {
+		position = 0;
+	}
+}
+
+#endif
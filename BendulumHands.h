@@ -0,0 +1,121 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumHands.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   A BendulumHands object drives the hands of an analog clock dial from a bendulum's time with a stepper motor,
+ *   through a step and direction driver, e.g. an A4988 or DRV8825 set for whatever microstepping suits the movement.
+ *   The motor takes stepsPerHour steps, or microsteps, for each hour the hands show; 4 to 500000 of them. Each step
+ *   is a HANDSWIDTH μs pulse on Timer1's OC1B pin, HANDSPIN, and the direction pin is held at whatever level turns
+ *   the hands clockwise. The hands only ever go clockwise.
+ *
+ *   The time is the sum of the beat durations beat() returns, counted from setTime(), like a BendulumPPS object's.
+ *   The hour is divided into stepsPerHour equal parts, by Bresenham's method, in whole μs and whole Timer1 ticks,
+ *   with no floating point. The hands take one step at the start of each part, so the steps are evenly spaced
+ *   rather than bunched up around the beats. The steps are made by Timer1's compare unit B (see BendulumTimer.h),
+ *   exactly on time, however long loop() takes. After each beat, addBeat() adds the beat's duration and lines the
+ *   parts up with the bendulum's time again; in between they're timed by the Arduino's clock.
+ *
+ *   setHands() tells the BendulumHands object where the hands are, and setTime() what time it is. If the hands are
+ *   behind, they catch up, going no faster than maxRate steps a second. If they're ahead, by less than six hours,
+ *   they wait for the time to catch up with them. getLag() says how far behind they are.
+ *
+ *       Bendulum myBendulum;
+ *       BendulumHands hands;
+ *       void setup() {
+ *           hands.begin(4096, 400, 8, HIGH);        // 4096 steps per hour, at most 400 a second, DIR on pin 8
+ *           hands.setHands(12, 0, 0);               // Where the hands were left
+ *           hands.setTime(9, 41, 30);               // What time it is
+ *       }
+ *       void loop() {
+ *           long beatDur = myBendulum.beat();
+ *           hands.addBeat(beatDur, myBendulum.getPassTime());
+ *       }
+ *
+ *   Only one BendulumHands object can be in use, and only on AVR processors. Its interrupt handler is defined in
+ *   this header, so only a sketch that includes it gets it (see BendulumTimer.h).
+ *
+ ****/
+
+#ifndef BendulumHands_H
+#define BendulumHands_H
+
+#ifdef __AVR__
+
+#include "BendulumTimer.h"
+
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define HANDSPIN	(12)						// The pin the step pulses come out on (OC1B)
+#else
+#define HANDSPIN	(10)						// The pin the step pulses come out on (OC1B)
+#endif
+#define HANDSWIDTH	(40)						// Duration of each step pulse (μs)
+#define HANDSMARGIN	(32)						// Min time (ticks) ahead of a step the compare unit must be set up
+
+// States of the step output
+#define HANDS_IDLE		(0)						// Not started; no time yet
+#define HANDS_WAITING	(1)						// Waiting for the next step to come within range of the compare unit
+#define HANDS_ARMED		(2)						// The compare unit will start a step pulse at the match
+#define HANDS_HIGH		(3)						// A step pulse is on; the compare unit will end it at the match
+
+class BendulumHands {
+private:
+	long stepsPerHour;						// Number of steps per hour of the dial
+	long cycle;								// Number of steps per turn of the dial (12 hours)
+	long stepUs;							// Duration (μs) of a step: stepUs + stepUsFrac / stepsPerHour
+	long stepUsFrac;
+	long stepTicks;							// Duration (ticks) of a step: stepTicks + stepTicksFrac / stepsPerHour
+	long stepTicksFrac;
+	long minInterval;						// Min time (ticks) between steps
+	long steps;								// Steps of the bendulum's time at the last pass
+	long phase;								// Plus this many μs
+	long phaseErr;							// Bresenham error term of the μs count (1 / stepsPerHour μs)
+	boolean started;						// Whether there's been a beat
+	boolean timeSet;						// Whether setTime() has been invoked
+	unsigned long lastPass;					// Clock time (μs) of the last pass, or of setTime() before the first
+	volatile byte state;					// State of the step output: HANDS_IDLE, HANDS_WAITING, etc.
+	volatile long due;						// The steps the hands should have taken by now
+	volatile long position;					// The steps they have taken
+	volatile unsigned long boundary;		// Time (ticks) at which due next goes up
+	volatile long boundaryErr;				// Bresenham error term of the tick count (1 / stepsPerHour ticks)
+	volatile unsigned long stepAt;			// Time (ticks) of the step the compare unit is set up for
+	volatile boolean atBoundary;			// Whether that step is the one at boundary
+	volatile unsigned long lastStep;		// Time (ticks) of the start of the last step
+
+	long toSteps(byte hour, byte minute, byte sec, long *us);
+											// Convert a time of day to steps and μs
+	void resync(unsigned long passTicks, boolean force);
+											// Line the steps up with the bendulum's time; passTicks when phase is
+	void service();							// Count the steps due and set up the next one; interrupts off
+	void stepped(unsigned long t);			// A step pulse started at time t (ticks): set up its end
+
+public:
+	BendulumHands();						// Instantiate a BendulumHands object
+	void begin(long perHour, unsigned int maxRate, byte dirPin, byte dirLevel);
+											// Set up the pins and the stepping and start Timer1
+	void setHands(byte hour, byte minute, byte sec);
+											// Say where the hands are
+	void setTime(byte hour, byte minute, byte sec);
+											// Set the time of day to hour:minute:sec now
+	void addBeat(long beatDur, unsigned long passTime);
+											// Add a beat of beatDur μs that ended at clock time passTime (μs)
+	long getLag();							// Get the number of steps the hands are behind (< 0 if ahead)
+	void handleCompare();					// Handle Timer1's compare B interrupt (used internally)
+	static BendulumHands *active;			// The BendulumHands object in use, if any (used internally)
+};
+
+#ifndef BENDULUM_NO_ISR
+// Timer1's compare unit B has matched: pass it on to the BendulumHands object (see BendulumTimer.h for why it's here)
+ISR(TIMER1_COMPB_vect) {
+	if (BendulumHands::active != NULL) {
+		BendulumHands::active->handleCompare();
+	}
+}
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,185 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumPPS.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See BendulumPPS.h for a description of what a BendulumPPS object does and how to use it.
+ *
+ ****/
+
+#define BENDULUM_NO_ISR							// The handlers are for the sketch (see BendulumTimer.h)
+#include "BendulumPPS.h"
+
+#ifdef __AVR__
+
+BendulumPPS *BendulumPPS::active = NULL;
+
+/*
+ *
+ * Constructor
+ *
+ */
+// Instantiate a BendulumPPS object. It does nothing until begin() is invoked.
+BendulumPPS::BendulumPPS() {
+	state = PPS_IDLE;
+	seconds = 0;
+	micro = 0;
+	secondTicks = 1000000L * TIMERTICKS;
+	lastPulse = 0;
+	interval = 0;
+	fresh = false;
+	resetJitter();
+}
+
+/*
+ *
+ * Public methods
+ *
+ */
+// Start Timer1, make the output pin an output, low, and have compare unit A interrupt. The pulses start with the
+// first beat.
+void BendulumPPS::begin() {
+	BendulumTimer::begin();
+	digitalWrite(PPSPIN, LOW);					// When the compare unit lets go of the pin, this is what it shows
+	pinMode(PPSPIN, OUTPUT);
+	noInterrupts();
+	active = this;
+	TIFR1 = _BV(OCF1A);
+	TIMSK1 |= _BV(OCIE1A);
+	interrupts();
+}
+
+// Add a beat of beatDur μs, as returned by beat(), that ended at clock time passTime, as returned by getPassTime().
+// The first beat's pass is where the bendulum's time starts. Work out the clock time at which the next second of
+// bendulum time starts, correcting for the Arduino clock's error, bias, in tenths of a second per day, and, unless
+// the compare unit is already set up for it, make that the next edge.
+void BendulumPPS::addBeat(long beatDur, unsigned long passTime, int bias) {
+	unsigned long passTicks = BendulumTimer::fromMicros(passTime);	// Time (ticks) of the pass
+	long toGo;									// Bendulum time (μs) from the pass to the next second
+	unsigned long t;							// Time (ticks) of the next edge
+	unsigned long next;							// The second it starts
+	float perUs;								// Ticks per μs of bendulum time: a μs of the Arduino's clock is
+												//   1 + bias / 864000 μs of the corrected clock
+
+	if (state == PPS_IDLE) {					// If first beat, the bendulum's time starts now
+		seconds = 0;
+		micro = 0;
+		nextSecond = 1;
+	} else {									// Otherwise, count the beat
+		micro += beatDur;
+		while (micro >= 1000000L) {
+			micro -= 1000000L;
+			seconds++;
+		}
+	}
+	perUs = TIMERTICKS * 864000.0 / (864000L + bias);
+	secondTicks = (long)round(1000000L * perUs);
+	noInterrupts();
+	next = nextSecond;
+	interrupts();
+	toGo = (long)(next - seconds) * 1000000L - micro;
+	if (toGo < 0) {								// If that second has already started, the edge is overdue
+		toGo = 0;
+	}
+	t = passTicks + (long)round(toGo * perUs);
+	noInterrupts();
+	if (fresh) {								// Note the time between the last two pulses
+		if (interval < minInterval) {
+			minInterval = interval;
+		}
+		if (interval > maxInterval) {
+			maxInterval = interval;
+		}
+		fresh = false;
+	}
+	if (state == PPS_IDLE) {
+		state = PPS_WAITING;
+	}
+	if (state != PPS_ARMED && next == nextSecond) {
+		edge = t;								// Unless it's already set up, or a pulse started while we worked
+		if (state == PPS_WAITING) {				//   it out, that's the next edge
+			arm();
+		}
+	}
+	interrupts();
+}
+
+// Get the whole seconds of bendulum time since the first beat, as of the last pass
+unsigned long BendulumPPS::getSeconds() {
+	return seconds;
+}
+
+// Start measuring the times between pulses afresh
+void BendulumPPS::resetJitter() {
+	minInterval = 0xFFFFFFFFUL;
+	maxInterval = 0;
+}
+
+// Get the shortest and longest times between pulses since resetJitter(), in ticks (TIMERTICKS per μs). If none
+// has been measured yet, the shortest is 0xFFFFFFFF and the longest 0.
+unsigned long BendulumPPS::getMinInterval() {
+	return minInterval;
+}
+unsigned long BendulumPPS::getMaxInterval() {
+	return maxInterval;
+}
+
+// Handle Timer1's compare A interrupt. The compare unit matches each time Timer1 passes OCR1A, so, even when it
+// isn't set up for an edge, this is invoked every 65536 ticks, which is how a waiting edge is noticed once it comes
+// within range.
+void BendulumPPS::handleCompare() {
+	switch (state) {
+		case PPS_WAITING:						// Waiting: see whether the edge is near enough yet
+			arm();
+			break;
+		case PPS_ARMED:							// The compare unit has just set the pin: the pulse has started
+			pulse(edge);
+			break;
+		case PPS_HIGH:							// The compare unit has just cleared the pin: let go of it and
+			TCCR1A &= ~(_BV(COM1A1) | _BV(COM1A0));	//   wait for the next edge
+			state = PPS_WAITING;
+			arm();
+			break;
+	}
+}
+
+/*
+ *
+ * Private methods
+ *
+ */
+// If the next edge is within range of the compare unit, set it up to set the pin then. If the edge is too near for
+// that, or overdue, set the pin now. Interrupts must be off.
+void BendulumPPS::arm() {
+	unsigned long t = BendulumTimer::now();		// Time now (ticks)
+
+	if ((long)(edge - t) < PPSMARGIN) {
+		TCCR1A |= _BV(COM1A1) | _BV(COM1A0);	// Set the pin by forcing a match
+		TCCR1C = _BV(FOC1A);
+		pulse(t);
+	} else if (edge - t < 0x10000UL - PPSMARGIN) {
+		OCR1A = (unsigned int)edge;				// Set the pin at the match
+		TCCR1A |= _BV(COM1A1) | _BV(COM1A0);
+		state = PPS_ARMED;
+	}
+}
+
+// The pulse started at time t (ticks). Have the compare unit clear the pin PPSWIDTH μs later, note the time between
+// pulses and, until the next beat says otherwise, expect the next second to start a second after this one.
+void BendulumPPS::pulse(unsigned long t) {
+	OCR1A = (unsigned int)(t + PPSWIDTH * TIMERTICKS);
+	TCCR1A = (TCCR1A & ~_BV(COM1A0)) | _BV(COM1A1);
+	state = PPS_HIGH;
+	if (lastPulse != 0) {
+		interval = t - lastPulse;
+		fresh = true;
+	}
+	lastPulse = t;
+	edge = t + secondTicks;
+	nextSecond++;
+}
+
+#endif
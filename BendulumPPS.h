@@ -0,0 +1,102 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumPPS.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   A BendulumPPS object makes a one pulse per second output from a bendulum's time, for other equipment to
+ *   synchronize to. The pulses come out on Timer1's OC1A pin, PPSPIN, each going high at the start of a second and
+ *   staying high for PPSWIDTH μs.
+ *
+ *   The bendulum's time is the sum of the beat durations beat() returns, counted from the first pass the
+ *   BendulumPPS object is told about. Those durations are whole μs, with any fraction of a μs in the estimate carried
+ *   from beat to beat, so the sum keeps the estimate's full precision. After each beat, addBeat() adds the beat's
+ *   duration and works out when, by the Arduino's clock, corrected by getBias(), the next second starts. The edges
+ *   themselves are made by Timer1's compare unit A (see BendulumTimer.h), so they're neither late by however long
+ *   loop() takes to get round to them nor subject to interrupt latency. Until the next beat arrives, each second is
+ *   taken to follow the last one by a second of the Arduino's corrected clock.
+ *
+ *       Bendulum myBendulum;
+ *       BendulumPPS pps;
+ *       void setup() {
+ *           pps.begin();
+ *       }
+ *       void loop() {
+ *           long beatDur = myBendulum.beat();
+ *           pps.addBeat(beatDur, myBendulum.getPassTime(), myBendulum.getBias());
+ *       }
+ *
+ *   To measure the jitter of the pulses, invoke resetJitter() and, some time later, getMinInterval() and
+ *   getMaxInterval(): the shortest and longest times between pulses since then, in Timer1 ticks (TIMERTICKS per μs).
+ *   At most one interval is measured per beat.
+ *
+ *   Only one BendulumPPS object can be in use, and only on AVR processors. Its interrupt handler is defined in this
+ *   header, so only a sketch that includes it gets it (see BendulumTimer.h).
+ *
+ ****/
+
+#ifndef BendulumPPS_H
+#define BendulumPPS_H
+
+#ifdef __AVR__
+
+#include "BendulumTimer.h"
+
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define PPSPIN		(11)						// The pin the pulses come out on (OC1A)
+#else
+#define PPSPIN		(9)							// The pin the pulses come out on (OC1A)
+#endif
+#define PPSWIDTH	(10000)						// Duration of each pulse (μs); at most 32767 / TIMERTICKS
+#define PPSMARGIN	(32)						// Min time (ticks) ahead of an edge the compare unit must be set up
+
+// States of the pulse output
+#define PPS_IDLE	(0)							// Not started; no beats yet
+#define PPS_WAITING	(1)							// Waiting for the next edge to come within range of the compare unit
+#define PPS_ARMED	(2)							// The compare unit will set the pin at the next edge
+#define PPS_HIGH	(3)							// The pin is high; the compare unit will clear it at the end of the pulse
+
+class BendulumPPS {
+private:
+	unsigned long seconds;					// Whole seconds of bendulum time at the last pass
+	long micro;								// Plus this many μs
+	long secondTicks;						// Duration (ticks) of a second by the Arduino's corrected clock
+	unsigned long minInterval;				// Shortest time (ticks) between pulses since resetJitter()
+	unsigned long maxInterval;				// Longest time (ticks) between pulses since resetJitter()
+	volatile byte state;					// State of the pulse output: PPS_IDLE, PPS_WAITING, etc.
+	volatile unsigned long nextSecond;		// The second of bendulum time whose start the next pulse marks
+	volatile unsigned long edge;			// Time (ticks) of the next edge
+	volatile unsigned long lastPulse;		// Time (ticks) of the start of the last pulse
+	volatile unsigned long interval;		// Time (ticks) from the pulse before that; 0 if none yet
+	volatile boolean fresh;					// Whether interval hasn't been looked at yet
+
+	void arm();								// Set up the compare unit if the next edge is near; interrupts off
+	void pulse(unsigned long t);			// The pulse has started at time t (ticks): set up its end
+
+public:
+	BendulumPPS();							// Instantiate a BendulumPPS object
+	void begin();							// Start Timer1 and set up the output pin
+	void addBeat(long beatDur, unsigned long passTime, int bias);
+											// Add a beat of beatDur μs that ended at clock time passTime (μs)
+	unsigned long getSeconds();				// Get the whole seconds of bendulum time so far
+	void resetJitter();						// Start measuring the times between pulses afresh
+	unsigned long getMinInterval();			// Get the shortest time (ticks) between pulses since resetJitter()
+	unsigned long getMaxInterval();			// Get the longest time (ticks) between pulses since resetJitter()
+	void handleCompare();					// Handle Timer1's compare A interrupt (used internally)
+	static BendulumPPS *active;				// The BendulumPPS object in use, if any (used internally)
+};
+
+#ifndef BENDULUM_NO_ISR
+// Timer1's compare unit A has matched: pass it on to the BendulumPPS object (see BendulumTimer.h for why it's here)
+ISR(TIMER1_COMPA_vect) {
+	if (BendulumPPS::active != NULL) {
+		BendulumPPS::active->handleCompare();
+	}
+}
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumTimer.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See BendulumTimer.h for a description of the time base and what uses it.
+ *
+ ****/
+
+#define BENDULUM_NO_ISR							// The handlers are for the sketch (see BendulumTimer.h)
+#include "BendulumTimer.h"
+
+#ifdef __AVR__
+
+volatile unsigned int BendulumTimer::overflows = 0;
+static boolean running = false;				// Whether begin() has been invoked
+
+// Start Timer1 counting freely at F_CPU / 8, with its overflow interrupt on. The Arduino core sets it up for
+// analogWrite(); take it over from that.
+void BendulumTimer::begin() {
+	if (running) {
+		return;
+	}
+	noInterrupts();
+	TCCR1A = 0;									// Normal mode, both compare outputs disconnected
+	TCCR1B = _BV(CS11);							// Clock / 8
+	TCNT1 = 0;
+	TIFR1 = _BV(TOV1);							// Clear any overflow that was pending
+	TIMSK1 = _BV(TOIE1);						// Interrupt on overflow
+	running = true;
+	interrupts();
+}
+
+// Get the current time in ticks. If Timer1 has overflowed since interrupts were turned off (e.g. when this is
+// invoked from an interrupt handler), the overflow won't have been counted yet, so allow for it.
+unsigned long BendulumTimer::now() {
+	byte oldSREG = SREG;						// Whether interrupts were on
+	unsigned int low;							// The timer itself
+	unsigned int high;							// Its overflows
+
+	noInterrupts();
+	low = TCNT1;
+	high = overflows;
+	if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+		high++;
+	}
+	SREG = oldSREG;
+	return ((unsigned long)high << 16) | low;
+}
+
+// Get the time in ticks of the clock time t, as returned by micros(), a little while ago. Compare the two clocks
+// now, with interrupts off so that neither moves on while we do, and count back.
+unsigned long BendulumTimer::fromMicros(unsigned long t) {
+	byte oldSREG = SREG;						// Whether interrupts were on
+	unsigned long ticks;						// Time now in ticks
+	unsigned long us;							// Time now in μs
+
+	noInterrupts();
+	ticks = now();
+	us = micros();
+	SREG = oldSREG;
+	return ticks - (us - t) * TIMERTICKS;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumTimer.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   The hardware time base shared by the outputs a bendulum's time can drive, e.g. a BendulumPPS object. micros() only
+ *   counts in 4 μs steps, and anything scheduled from loop() is late by however long loop() takes to get round to it.
+ *   So the outputs are timed by the AVR's 16-bit Timer1 instead, running freely at F_CPU / 8, which is TIMERTICKS ticks
+ *   per μs; F_CPU has to be a multiple of 8 MHz (16 MHz, say) for that to be a whole number, and anything else is a
+ *   compile-time error. Its overflows are counted to make the count 32 bits long. That wraps about every 35 minutes at
+ *   16 MHz, so only times less than half that apart can be compared. Each output that uses it has one of Timer1's
+ *   compare units to itself, so its edges are made by the timer hardware, exactly on time:
+ *
+ *       Compare unit A (pin OC1A)     BendulumPPS
+ *       Compare unit B (pin OC1B)     BendulumHands
+ *
+ *   begin() takes Timer1 over from the Arduino core, so analogWrite() on the pins it drives (9 and 10 on an Uno, 11
+ *   and 12 on a Mega) and libraries that also use it, like Servo, can't be used alongside.
+ *
+ *   The interrupt handlers for Timer1 are defined in this header and in those of the outputs, not in the library's
+ *   .cpp files, since the Arduino IDE links all of those into every sketch that uses the library, and a handler
+ *   linked in claims its interrupt even if nothing ever uses it. So a sketch only gets them, and only loses Timer1, by
+ *   including the header of an output it uses. BendulumDisplay.h does the same for Timer2. A sketch made up of more
+ *   than one file includes each such header in one of them, and #defines BENDULUM_NO_ISR before including it in any
+ *   of the others.
+ *
+ ****/
+
+#ifndef BendulumTimer_H
+#define BendulumTimer_H
+
+#ifdef __AVR__
+
+#if ARDUINO >= 100
+  #include <Arduino.h>  // Arduino 1.0
+#else
+  #include <WProgram.h> // Arduino 0022
+#endif
+
+#if F_CPU % 8000000L != 0						// TIMERTICKS has to be a whole number
+  #error "BendulumTimer needs F_CPU to be a multiple of 8 MHz"
+#endif
+#define TIMERTICKS	(F_CPU / 8000000L)			// Number of Timer1 ticks per μs
+
+class BendulumTimer {
+public:
+	static volatile unsigned int overflows;	// Number of times Timer1 has overflowed (used internally)
+	static void begin();					// Start Timer1 running freely, if it isn't already
+	static unsigned long now();				// Get the current time in ticks
+	static unsigned long fromMicros(unsigned long t);
+											// Get the time in ticks of the recent clock time t (μs) from micros()
+};
+
+#ifndef BENDULUM_NO_ISR
+// Count Timer1's overflows: the high half of the time
+ISR(TIMER1_OVF_vect) {
+	BendulumTimer::overflows++;
+}
+#endif
+
+#endif
+
+#endif
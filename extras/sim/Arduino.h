@@ -0,0 +1,106 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   Arduino.h (host simulator) Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   A stand-in for the Arduino core, just big enough to compile the Bendulum library on a host computer. The types
+ *   and constants are the Arduino ones; the hardware functions are implemented by BendulumSim (see BendulumSim.h),
+ *   which simulates the bendulum, the coil and the Arduino clock behind them.
+ *
+ *   There are no interrupts on the host, so noInterrupts() and interrupts() do nothing, and __AVR__ isn't defined,
+ *   so the library compiles as it would for the ARM-based boards. long and unsigned long are 64 bits on most hosts,
+ *   not 32 as on the Arduino, which is why the library keeps its times and durations in int32_t and uint32_t and why
+ *   micros() here returns a uint32_t: it wraps around, and the library's arithmetic overflows, just where they would
+ *   on an Arduino. (int is still 32 bits, not 16 as on an AVR, and double is still double, not float.)
+ *
+ *   The library's AVR-only outputs, BendulumPPS and the like, are the exception. outputs.cpp compiles them, and
+ *   itself, with __AVR__ and F_CPU defined, and then this header includes AvrSim.h, whose simulated timers and
+ *   registers stand in for the AVR's, and the hardware functions are implemented by AvrSim instead (see AvrSim.h).
+ *
+ ****/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH		(1)
+#define LOW			(0)
+#define INPUT		(0)
+#define OUTPUT		(1)
+#define DEFAULT		(1)
+#define EXTERNAL	(0)
+#define A0			(14)
+#define A1			(15)
+#define A2			(16)
+#define A3			(17)
+#define PI			(3.1415926535897932384626433832795)
+#define TWO_PI		(6.283185307179586476925286766559)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+uint32_t micros();							// Clock time (μs)
+uint32_t millis();							// Clock time (ms)
+void delay(unsigned long ms);				// Wait ms clock milliseconds
+void delayMicroseconds(unsigned int us);	// Wait us clock microseconds
+int analogRead(uint8_t pin);				// Read the coil (0 - 1023)
+void analogReference(uint8_t type);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+#ifdef __AVR__
+#include "AvrSim.h"								// The AVR's timers, for the library's AVR-only outputs
+#else
+inline void noInterrupts() {}
+inline void interrupts() {}
+#endif
+
+// Just as much of the Arduino Stream (and the Print it's built on) as the library uses. A driver derives its own
+// stream from it, supplying the characters that arrive and taking the ones written.
+class Stream {
+public:
+	virtual int available() = 0;			// Number of characters that have arrived and not been read
+	virtual int read() = 0;					// Read the next character (-1 if none)
+	virtual int peek() = 0;					// The next character, without reading it (-1 if none)
+	virtual int availableForWrite() = 0;	// Number of characters that can be written without waiting
+	virtual size_t write(uint8_t c) = 0;	// Write a character
+	virtual ~Stream() {}
+
+	size_t print(const char *s) {
+		size_t n = 0;
+		while (*s != '\0') {
+			n += write(*s++);
+		}
+		return n;
+	}
+	size_t print(char c) {
+		return write(c);
+	}
+	size_t print(long n) {
+		char buf[24];
+		snprintf(buf, sizeof(buf), "%ld", n);
+		return print(buf);
+	}
+	size_t print(int n) {
+		return print((long)n);
+	}
+	size_t println() {
+		return print("\r\n");
+	}
+	template <class T> size_t println(T x) {
+		size_t n = print(x);
+		return n + println();
+	}
+};
+
+#endif
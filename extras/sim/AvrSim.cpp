@@ -0,0 +1,325 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   AvrSim.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See AvrSim.h for a description of what an AvrSim object does and how to use it.
+ *
+ ****/
+
+#include "Arduino.h"
+
+#define TIMERDIV	(8)							// Number of cycles per Timer1 tick
+#define MICROSTIME	(4)							// Time (μs) a micros() takes, and how finely it counts
+
+SimCounter TCNT1 = {1}, TCNT2 = {2};
+SimFlags TIFR1, TIFR2;
+SimStrobe TCCR1C;
+SimStatus SREG;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TCCR2A, TCCR2B, TIMSK2, OCR2A;
+volatile uint16_t OCR1A, OCR1B;
+volatile uint8_t PORTB, PORTC, PORTD;
+
+static volatile uint8_t *const portRegs[3] = {&PORTB, &PORTC, &PORTD};
+static const uint8_t portPins[3] = {8, A0, 0};	// The pin number of bit 0 of each
+static const uint16_t prescale2[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+												// Number of cycles per Timer2 tick for each clock select
+
+AvrSim avr;
+
+/*
+ *
+ * The interrupt vectors
+ *
+ */
+// The handlers a sketch defines with ISR() take the place of these. An AVR with an interrupt enabled and no handler
+// for it resets; stop the run instead.
+static void badInterrupt(const char *vector) {
+	fprintf(stderr, "AvrSim: %s interrupt enabled with no handler linked in\n", vector);
+	exit(2);
+}
+
+extern "C" __attribute__((weak)) void TIMER2_COMPA_vect() {
+	badInterrupt("TIMER2_COMPA");
+}
+
+extern "C" __attribute__((weak)) void TIMER1_COMPA_vect() {
+	badInterrupt("TIMER1_COMPA");
+}
+
+extern "C" __attribute__((weak)) void TIMER1_COMPB_vect() {
+	badInterrupt("TIMER1_COMPB");
+}
+
+extern "C" __attribute__((weak)) void TIMER1_OVF_vect() {
+	badInterrupt("TIMER1_OVF");
+}
+
+/*
+ *
+ * The registers
+ *
+ */
+SimCounter::operator uint16_t() const {
+	return avr.getCount(timer);
+}
+
+SimCounter &SimCounter::operator=(uint16_t v) {
+	avr.setCount(timer, v);
+	return *this;
+}
+
+SimStrobe &SimStrobe::operator=(uint8_t v) {
+	avr.force(v);
+	return *this;
+}
+
+SimStatus &SimStatus::operator=(uint8_t v) {
+	bits = v;
+	if (v & _BV(SREG_I)) {
+		avr.dispatch();
+	}
+	return *this;
+}
+
+/*
+ *
+ * AvrSim
+ *
+ */
+AvrSim::AvrSim() {
+	begin();
+}
+
+// Reset the processor, except that interrupts are on, as the Arduino core has them before setup()
+void AvrSim::begin() {
+	TCCR1A = TCCR1B = TIMSK1 = TCCR2A = TCCR2B = TIMSK2 = OCR2A = 0;
+	OCR1A = OCR1B = 0;
+	TIFR1.bits = TIFR2.bits = 0;
+	PORTB = PORTC = PORTD = 0;
+	SREG.bits = _BV(SREG_I);
+	now = 0;
+	zero = zero2 = 0;
+	oc[0] = oc[1] = LOW;
+	ports[0] = ports[1] = ports[2] = 0;
+	edges.clear();
+}
+
+uint64_t AvrSim::getTime() {
+	return now;
+}
+
+void AvrSim::advance(uint64_t cycles) {
+	advanceTo(now + cycles);
+}
+
+// Advance time to t, going from one of the timers' events to the next. At each, the compare units that match act on
+// their pins, the flags are set and, if interrupts are on, the handlers of the enabled interrupts are invoked.
+void AvrSim::advanceTo(uint64_t t) {
+	uint64_t next;								// Time (cycles) of the next event
+	uint64_t m;									// Time (cycles) of one of the events
+	uint8_t flags;								// The Timer1 flags the next event sets
+	boolean match2;								// Whether it's a Timer2 compare match, too
+
+	notePorts();
+	while (true) {
+		next = UINT64_MAX;
+		flags = 0;
+		if ((TCCR1B & 0x07) != 0) {
+			next = nextMatch(0) * TIMERDIV;
+			flags = _BV(TOV1);
+			m = nextMatch(OCR1A) * TIMERDIV;
+			if (m <= next) {
+				flags = m < next ? _BV(OCF1A) : flags | _BV(OCF1A);
+				next = m;
+			}
+			m = nextMatch(OCR1B) * TIMERDIV;
+			if (m <= next) {
+				flags = m < next ? _BV(OCF1B) : flags | _BV(OCF1B);
+				next = m;
+			}
+		}
+		match2 = false;
+		if (div2() != 0) {						// In CTC mode, Timer2 counts up to OCR2A and then starts again
+			m = (ticks2() + (OCR2A + OCR2A - getCount(2)) % (OCR2A + 1) + 1) * div2();
+			if (m <= next) {
+				flags = m < next ? 0 : flags;
+				match2 = true;
+				next = m;
+			}
+		}
+		if (next > t) {
+			break;
+		}
+		now = next;
+		if (flags & _BV(OCF1A)) {
+			compare(0);
+		}
+		if (flags & _BV(OCF1B)) {
+			compare(1);
+		}
+		TIFR1.bits |= flags;
+		if (match2) {
+			TIFR2.bits |= _BV(OCF2A);
+		}
+		dispatch();
+		notePorts();
+	}
+	now = t > now ? t : now;
+}
+
+// micros() on a 16 MHz AVR counts in 4 μs steps and takes about that long
+uint32_t AvrSim::micros() {
+	uint32_t answer = (uint32_t)(now / CYCLESPERUS) & ~(uint32_t)(MICROSTIME - 1);
+
+	advance(MICROSTIME * CYCLESPERUS);
+	return answer;
+}
+
+uint16_t AvrSim::getCount(uint8_t timer) {
+	if (timer == 2) {
+		return div2() == 0 ? 0 : (ticks2() - zero2) % (OCR2A + 1);
+	}
+	return (uint16_t)(ticks() - zero);
+}
+
+void AvrSim::setCount(uint8_t timer, uint16_t v) {
+	if (timer == 2) {
+		zero2 = ticks2() - v;
+	} else {
+		zero = ticks() - v;
+	}
+}
+
+void AvrSim::force(uint8_t foc) {
+	if (foc & _BV(FOC1A)) {
+		compare(0);
+	}
+	if (foc & _BV(FOC1B)) {
+		compare(1);
+	}
+}
+
+// Invoke the handlers of the interrupts that are flagged and enabled, highest priority first, for as long as
+// interrupts are on. Invoking a handler clears its flag, and interrupts are off while it runs.
+void AvrSim::dispatch() {
+	uint8_t pending;							// The flagged and enabled interrupts
+
+	while ((SREG.bits & _BV(SREG_I)) &&
+		((pending = TIFR1.bits & TIMSK1 & 0x07) != 0 || (TIFR2.bits & TIMSK2 & _BV(OCF2A)) != 0)) {
+		SREG.bits &= ~_BV(SREG_I);
+		if (TIFR2.bits & TIMSK2 & _BV(OCF2A)) {
+			TIFR2.bits &= ~_BV(OCF2A);
+			TIMER2_COMPA_vect();
+		} else if (pending & _BV(OCF1A)) {
+			TIFR1.bits &= ~_BV(OCF1A);
+			TIMER1_COMPA_vect();
+		} else if (pending & _BV(OCF1B)) {
+			TIFR1.bits &= ~_BV(OCF1B);
+			TIMER1_COMPB_vect();
+		} else {
+			TIFR1.bits &= ~_BV(TOV1);
+			TIMER1_OVF_vect();
+		}
+		SREG.bits |= _BV(SREG_I);
+	}
+}
+
+uint64_t AvrSim::ticks() {
+	return now / TIMERDIV;
+}
+
+uint64_t AvrSim::ticks2() {
+	return div2() == 0 ? 0 : now / div2();
+}
+
+uint32_t AvrSim::div2() {
+	return prescale2[TCCR2B & 0x07];
+}
+
+uint64_t AvrSim::nextMatch(uint16_t v) {
+	return ticks() + (uint16_t)(v - getCount(1) - 1) + 1;
+}
+
+// Compare unit 0 (A) or 1 (B) has matched, or been forced to: set, clear or toggle its pin as its COM bits say
+void AvrSim::compare(uint8_t unit) {
+	uint8_t com = (TCCR1A >> (unit == 0 ? COM1A0 : COM1B0)) & 0x03;
+	uint8_t level;								// The level the pin goes to
+	AvrEdge e;
+
+	if (com == 0) {								// Disconnected
+		return;
+	}
+	level = com == 1 ? !oc[unit] : (com == 3 ? HIGH : LOW);
+	if (level != oc[unit]) {
+		oc[unit] = level;
+		e.time = now;
+		e.pin = unit == 0 ? SIMOC1A : SIMOC1B;
+		e.level = level;
+		edges.push_back(e);
+	}
+}
+
+// Note each bit of PORTB, PORTC and PORTD that has changed since they were last looked at as an edge on its pin
+void AvrSim::notePorts() {
+	AvrEdge e;
+	uint8_t changed;							// The bits of a port that have changed
+
+	for (uint8_t p = 0; p < 3; p++) {
+		changed = *portRegs[p] ^ ports[p];
+		for (uint8_t b = 0; b < 8; b++) {
+			if (changed & _BV(b)) {
+				e.time = now;
+				e.pin = portPins[p] + b;
+				e.level = (*portRegs[p] >> b) & 1;
+				edges.push_back(e);
+			}
+		}
+		ports[p] = *portRegs[p];
+	}
+}
+
+/*
+ *
+ * The Arduino functions
+ *
+ */
+uint32_t micros() {
+	return avr.micros();
+}
+
+uint32_t millis() {
+	return avr.micros() / 1000;
+}
+
+uint8_t digitalPinToPort(uint8_t pin) {
+	return pin < 8 ? SIMPORTD : (pin < 14 ? SIMPORTB : (pin < 20 ? SIMPORTC : NOT_A_PIN));
+}
+
+volatile uint8_t *portOutputRegister(uint8_t port) {
+	return portRegs[port - SIMPORTB];
+}
+
+uint8_t digitalPinToBitMask(uint8_t pin) {
+	return _BV(pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - A0));
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+// Set or clear the pin's bit in its port. While a compare unit drives the pin, that doesn't show on it, as on an AVR.
+void digitalWrite(uint8_t pin, uint8_t value) {
+	if (digitalPinToPort(pin) == NOT_A_PIN) {
+		return;
+	}
+	if (value == LOW) {
+		*portOutputRegister(digitalPinToPort(pin)) &= ~digitalPinToBitMask(pin);
+	} else {
+		*portOutputRegister(digitalPinToPort(pin)) |= digitalPinToBitMask(pin);
+	}
+}
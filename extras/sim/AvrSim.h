@@ -0,0 +1,171 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   AvrSim.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   An AvrSim object simulates as much of an AVR processor as the library's AVR-only outputs use -- Timer1, its two
+ *   compare units and their pins, Timer2's compare unit A, the I/O ports, the interrupt flags and the global
+ *   interrupt enable -- so that the outputs can be run on a host computer and the edges they make checked. With
+ *   __AVR__ defined, the stand-in Arduino.h includes this header, and the registers declared here stand in for the
+ *   AVR's: reading TCNT1 reads the timer, writing a 1 to a bit of TIFR1 or TIFR2 clears that flag, writing FOC1A or
+ *   FOC1B to TCCR1C forces a match and turning interrupts on through SREG invokes the handlers of any that are
+ *   pending. The pins are numbered as on an Uno: 0 - 7 on PORTD, 8 - 13 on PORTB and A0 - A5 on PORTC.
+ *
+ *   Time is kept in CPU cycles at F_CPU. Between the events the timers make -- a compare match or an overflow --
+ *   nothing happens, so advance() goes from one to the next. At each, it sets the interrupt flag, has the compare
+ *   unit set, clear or toggle its pin as its COM bits say and, if interrupts are on and that interrupt is enabled,
+ *   invokes its handler, which the sketch defines with ISR() just as it would on an AVR. An interrupt that's enabled
+ *   with no handler linked in would reset an AVR; here it stops the run. Timer1 only runs at F_CPU / 8, the way
+ *   BendulumTimer runs it, and Timer2 only in CTC mode, the way BendulumDisplay runs it. micros() counts in 4 μs
+ *   steps, as it does at 16 MHz, and takes 4 μs; nothing else takes any time, handlers included.
+ *
+ *   Each edge a compare unit makes on its pin is noted in edges, with the time it was made, for the driver to check,
+ *   and so is each change to a pin's bit in PORTB, PORTC or PORTD. Those are noted after each event and whenever time
+ *   advances, so a change made outside a handler is noted as made at the next micros(), say.
+ *   Bear in mind that long is 64 bits here, not 32 as on an AVR, so a run has to stay clear of the half hour or so
+ *   after which the tick count wraps around.
+ *
+ ****/
+
+#ifndef AvrSim_H
+#define AvrSim_H
+
+#include <stdint.h>
+#include <vector>
+
+#define _BV(bit)	(1 << (bit))
+#define ISR(vector)	extern "C" void vector()	// Define the handler for an interrupt vector
+
+#define SREG_I		(7)							// SREG: global interrupt enable
+#define COM1A1		(7)							// TCCR1A: compare output modes
+#define COM1A0		(6)
+#define COM1B1		(5)
+#define COM1B0		(4)
+#define CS11		(1)							// TCCR1B: clock / 8
+#define FOC1A		(7)							// TCCR1C: force output compare
+#define FOC1B		(6)
+#define TOIE1		(0)							// TIMSK1 and TIFR1: overflow, compare A and compare B
+#define OCIE1A		(1)
+#define OCIE1B		(2)
+#define TOV1		(0)
+#define OCF1A		(1)
+#define OCF1B		(2)
+#define WGM21		(1)							// TCCR2A: CTC mode
+#define CS22		(2)							// TCCR2B: clock select
+#define CS21		(1)
+#define CS20		(0)
+#define OCIE2A		(1)							// TIMSK2 and TIFR2: compare A
+#define OCF2A		(1)
+
+#define CYCLESPERUS	(F_CPU / 1000000L)			// Number of cycles per μs
+
+#define SIMOC1A		(9)							// The pins the compare units drive, as on an Uno
+#define SIMOC1B		(10)
+#define NOT_A_PIN	(0)							// Arduino numbers for the ports
+#define SIMPORTB	(2)
+#define SIMPORTC	(3)
+#define SIMPORTD	(4)
+
+// TCNT1 and TCNT2: a timer's count
+class SimCounter {
+public:
+	uint8_t timer;							// 1 or 2
+	operator uint16_t() const;
+	SimCounter &operator=(uint16_t v);
+};
+
+// TIFR1 and TIFR2: interrupt flags, which writing a 1 to clears
+class SimFlags {
+public:
+	volatile uint8_t bits;
+	operator uint8_t() const {
+		return bits;
+	}
+	SimFlags &operator=(uint8_t v) {
+		bits &= ~v;
+		return *this;
+	}
+};
+
+// TCCR1C: writing FOC1A or FOC1B forces a match on that compare unit, without a flag or an interrupt
+class SimStrobe {
+public:
+	operator uint8_t() const {
+		return 0;
+	}
+	SimStrobe &operator=(uint8_t v);
+};
+
+// SREG: turning interrupts on invokes the handlers of any that are pending
+class SimStatus {
+public:
+	volatile uint8_t bits;
+	operator uint8_t() const {
+		return bits;
+	}
+	SimStatus &operator=(uint8_t v);
+};
+
+extern SimCounter TCNT1, TCNT2;
+extern SimFlags TIFR1, TIFR2;
+extern SimStrobe TCCR1C;
+extern SimStatus SREG;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TCCR2A, TCCR2B, TIMSK2, OCR2A;
+extern volatile uint16_t OCR1A, OCR1B;
+extern volatile uint8_t PORTB, PORTC, PORTD;
+
+uint8_t digitalPinToPort(uint8_t pin);		// The port pin is on, or NOT_A_PIN
+volatile uint8_t *portOutputRegister(uint8_t port);
+uint8_t digitalPinToBitMask(uint8_t pin);	// pin's bit in its port
+
+inline void noInterrupts() {
+	SREG = SREG & ~_BV(SREG_I);
+}
+inline void interrupts() {
+	SREG = SREG | _BV(SREG_I);
+}
+
+struct AvrEdge {
+	uint64_t time;							// Time (cycles) the edge was made
+	uint8_t pin;							// The pin it was made on
+	uint8_t level;							// The level the pin went to
+};
+
+class AvrSim {
+public:
+	std::vector<AvrEdge> edges;				// The edges the compare units have made, in order
+
+	AvrSim();								// A processor just out of reset
+	void begin();							// Reset it: all the registers, the time and edges to 0
+	uint64_t getTime();						// Get the time (cycles) now
+	void advance(uint64_t cycles);			// Advance time by cycles, dealing with the timer's events
+	void advanceTo(uint64_t t);				// Advance time to t (cycles), if it's not already past
+	uint32_t micros();						// The Arduino core's micros()
+
+	uint16_t getCount(uint8_t timer);		// Read TCNT1 or TCNT2 (used internally)
+	void setCount(uint8_t timer, uint16_t v);
+											// Write TCNT1 or TCNT2 (used internally)
+	void force(uint8_t foc);				// Force a match on the compare units in foc (used internally)
+	void dispatch();						// Invoke the handlers of the pending interrupts (used internally)
+
+private:
+	uint64_t now;							// Time (cycles) now
+	uint64_t zero;							// Time (ticks) at which TCNT1 was last 0
+	uint64_t zero2;							// Time (Timer2 ticks) at which TCNT2 was last 0
+	uint8_t oc[2];							// Levels of the OC1A and OC1B pins
+	uint8_t ports[3];						// What PORTB, PORTC and PORTD were when last looked at
+
+	uint64_t ticks();						// Time (ticks) now
+	uint64_t ticks2();						// Time (Timer2 ticks) now
+	uint32_t div2();						// Number of cycles per Timer2 tick; 0 if it's stopped
+	uint64_t nextMatch(uint16_t v);			// Time (ticks) after now at which TCNT1 next becomes v
+	void compare(uint8_t unit);				// Compare unit 0 (A) or 1 (B) has matched: act on its pin
+	void notePorts();						// Note the changes to the ports since they were last looked at
+};
+
+extern AvrSim avr;
+
+#endif
@@ -0,0 +1,302 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumSim.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   See BendulumSim.h for a description of what a BendulumSim object does and how to use it.
+ *
+ ****/
+
+#include "BendulumSim.h"
+
+#define ADCTIME		(112)						// Time (μs) an analogRead() takes
+#define MICROSTIME	(4)							// Time (μs) a micros() takes
+#define PINTIME		(5)							// Time (μs) a digitalWrite() takes
+#define DAY			(86400e6)					// Duration (μs) of a day
+
+BendulumSim sim;
+
+/*
+ *
+ * BendulumSimConfig
+ *
+ */
+BendulumSimConfig::BendulumSimConfig() {
+	tick = 600000;
+	tock = 610000;
+	jitter = 50;
+	amp = 600;
+	width = 8000;
+	noise = 0;
+	ring = 300;
+	ringTau = 15000;
+	ringPeriod = 6000;
+	kickBest = 6;
+	kickCoef = 0;
+	coastExtra = 0;
+	tempMean = 20;
+	tempSwing = 0;
+	tempCoef = 0;
+	drift = 0;
+	clockErr = 0;
+	microsStart = 0;
+	firstPass = 123457;
+	quietStep = 5000;
+	kickPin = 12;
+	seed = 42;
+}
+
+/*
+ *
+ * BendulumSim
+ *
+ */
+BendulumSim::BendulumSim() {
+	begin(BendulumSimConfig());
+}
+
+// Start afresh simulating config. The first pass is scheduled; the rest follow from it.
+void BendulumSim::begin(const BendulumSimConfig &config) {
+	cfg = config;
+	events = std::priority_queue<Event>();
+	rng.seed(cfg.seed);
+	now = 0;
+	lastPass = -1e18;						// Far enough back that its pulse is nil
+	nextPass = cfg.firstPass;
+	passes = 0;
+	disturbance = 0;
+	kickStart = -1;
+	kickEnd = quietFrom = -1e18;
+	kicked = false;
+	kickDelay = 0;
+	schedule(nextPass, PASS, 0);
+}
+
+// Lengthen the beat in progress at time t (μs) by amount μs. A push or a draught, say
+void BendulumSim::disturb(double t, double amount) {
+	schedule(t, DISTURB, amount);
+}
+
+double BendulumSim::getTime() {
+	return now;
+}
+
+double BendulumSim::getPassTime() {
+	return lastPass;
+}
+
+long BendulumSim::getPasses() {
+	return passes;
+}
+
+double BendulumSim::getBeatDuration() {
+	return (cfg.tick + cfg.tock) / 2;
+}
+
+// The temperature follows a sine wave, a day long, starting at tempMean and rising
+double BendulumSim::getTemp() {
+	return cfg.tempMean + cfg.tempSwing * sin(TWO_PI * now / DAY);
+}
+
+// Put an event of the given type and value in the queue, to happen at time t (μs)
+void BendulumSim::schedule(double t, EventType type, double value) {
+	Event e;
+
+	e.time = t;
+	e.type = type;
+	e.value = value;
+	events.push(e);
+}
+
+// Advance simulated time by dt μs, dealing with the events that fall in that time in order. At a PASS, the next
+// beat begins. At the CLOSE that follows it, whether and when the bendulum was kicked is known, so the beat's
+// duration is worked out and the next PASS scheduled. A DISTURB is added to the next beat to be worked out.
+void BendulumSim::advance(double dt) {
+	double beat;							// Duration (μs) of the beat in progress
+	double off;								// Kick delay (ms) off the best one
+
+	now += dt;
+	while (!events.empty() && events.top().time <= now) {
+		Event e = events.top();
+		events.pop();
+		switch (e.type) {
+			case PASS:
+				lastPass = e.time;
+				passes++;
+				kicked = false;
+				schedule(e.time + SIMKICKWINDOW, CLOSE, 0);
+				break;
+			case CLOSE:
+				beat = passes % 2 == 0 ? cfg.tick : cfg.tock;
+				beat += cfg.jitter * normal() + disturbance;
+				beat += cfg.tempCoef * cfg.tempSwing * sin(TWO_PI * lastPass / DAY);
+				beat += cfg.drift * lastPass / DAY;
+				if (kicked) {
+					off = kickDelay - cfg.kickBest;
+					beat += cfg.kickCoef * off * off;
+				} else {
+					beat += cfg.coastExtra;
+				}
+				disturbance = 0;
+				nextPass = lastPass + beat;
+				schedule(nextPass, PASS, 0);
+				break;
+			case DISTURB:
+				disturbance += e.value;
+				break;
+		}
+	}
+}
+
+// Time (μs) up to which no pass shows in the coil: until the next pass's pulse starts. If ringing is true, the
+// ringing from the last kick and the noise count, too, so it's now until the ringing has died away and, with
+// noise, it's always now.
+double BendulumSim::quietUntil(boolean ringing) {
+	double until;
+
+	if ((ringing && (cfg.noise > 0 || now < quietFrom)) || now < lastPass + SIMREACH * cfg.width) {
+		return now;
+	}
+	until = nextPass > lastPass ? nextPass - SIMREACH * cfg.width : lastPass + SIMKICKWINDOW;
+	return until > now ? until : now;
+}
+
+// Advance by dt μs or, if nothing will show in the coil for longer than that, by as much as quietStep μs. What
+// counts as showing is as for quietUntil()
+void BendulumSim::step(double dt, boolean ringing) {
+	double quiet = quietUntil(ringing) - now;
+
+	if (quiet > dt) {
+		dt = quiet < cfg.quietStep ? quiet : cfg.quietStep;
+	}
+	advance(dt);
+}
+
+// What pass number n, at time pass, induces in the coil at time t: the derivative of a Gaussian, whose positive
+// lobe comes before the pass on even-numbered passes and after it on odd-numbered ones, as it does going one way
+// and the other
+double BendulumSim::pulse(double t, double pass, long n) {
+	double u = (t - pass) / cfg.width;
+
+	if (u > SIMREACH || u < -SIMREACH) {
+		return 0;
+	}
+	return (n % 2 == 0 ? -1 : 1) * cfg.amp * u * exp(-u * u / 2) * exp(0.5);
+}
+
+// A standard normal variate, by the Box-Muller method
+double BendulumSim::normal() {
+	double u1 = (rng() + 1.0) / 4294967297.0;
+	double u2 = rng() / 4294967296.0;
+
+	return sqrt(-2 * log(u1)) * cos(TWO_PI * u2);
+}
+
+/*
+ *
+ * The Arduino functions
+ *
+ */
+// The Arduino clock's time, fast by clockErr and starting at microsStart. Reading the clock is what the library
+// does while it waits, so it skips ahead whenever no pass is near, ringing or not.
+uint32_t BendulumSim::micros() {
+	uint32_t answer = cfg.microsStart + (uint32_t)(uint64_t)(now * (1 + cfg.clockErr));
+
+	step(MICROSTIME, false);
+	return answer;
+}
+
+void BendulumSim::delay(unsigned long ms) {
+	advance(ms * 1000.0 / (1 + cfg.clockErr));
+}
+
+void BendulumSim::delayMicroseconds(unsigned int us) {
+	advance(us / (1 + cfg.clockErr));
+}
+
+// What the coil reads now: the pulses of the passes on either side, the ringing from the last kick and the noise,
+// clipped to what the ADC can read
+int BendulumSim::analogRead(uint8_t pin) {
+	double v = 0;
+	double t;								// Time (μs) since the last kick ended
+
+	(void)pin;
+	if (nextPass > lastPass) {
+		v += pulse(now, nextPass, passes + 1);
+	}
+	v += pulse(now, lastPass, passes);
+	if (now < quietFrom) {
+		t = now - kickEnd;
+		v += cfg.ring * exp(-t / cfg.ringTau) * cos(TWO_PI * t / cfg.ringPeriod);
+	}
+	if (cfg.noise > 0) {
+		v += cfg.noise * normal();
+	}
+	step(ADCTIME, true);
+	v = floor(v + 0.5);
+	return (int)(v < 0 ? 0 : (v > 1023 ? 1023 : v));
+}
+
+// Kicks start and end with the kick pin going HIGH and LOW. A kick that starts within SIMKICKWINDOW of a pass
+// changes the beat that pass began; its end starts the coil ringing. A kick can start a little before the pass it
+// follows, since the library may see the pass coming before the magnet is right over the coil, and then counts as
+// following it with a negative kick delay.
+void BendulumSim::digitalWrite(uint8_t pin, uint8_t value) {
+	if (pin == cfg.kickPin && value == HIGH) {
+		kickStart = now;
+	} else if (pin == cfg.kickPin && kickStart >= 0) {
+		if (kickStart - lastPass < SIMKICKWINDOW) {
+			kicked = true;
+			kickDelay = (kickStart - lastPass) / 1000;
+		}
+		kickStart = -1;
+		kickEnd = now;
+		quietFrom = cfg.ring > 0.5 ? now + cfg.ringTau * log(2 * cfg.ring) : now;
+	}
+	advance(PINTIME);
+}
+
+uint32_t micros() {
+	return sim.micros();
+}
+
+int simThermometer() {
+	return (int)floor(sim.getTemp() * 10 + 0.5);
+}
+
+uint32_t millis() {
+	return sim.micros() / 1000;
+}
+
+void delay(unsigned long ms) {
+	sim.delay(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+	sim.delayMicroseconds(us);
+}
+
+int analogRead(uint8_t pin) {
+	return sim.analogRead(pin);
+}
+
+void analogReference(uint8_t type) {
+	(void)type;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	sim.digitalWrite(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+	(void)pin;
+	return LOW;
+}
@@ -0,0 +1,141 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   BendulumSim.h Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   A BendulumSim object simulates a bendulum, its coil and the Arduino clock so that the library can be run on a
+ *   host computer, much faster than real time. It implements the Arduino functions declared in the stand-in Arduino.h
+ *   in this directory; the library calls them just as it would on an Arduino.
+ *
+ *   The simulation is driven by events rather than by stepping time along in small increments. Between passes over
+ *   the coil, nothing happens that the library can see, so there's no point simulating it. Events -- the magnet
+ *   passing over the coil (PASS), the end of the time in which a kick can follow a pass (CLOSE) and a disturbance to
+ *   the bendulum (DISTURB) -- are kept in a priority queue in order of time and are dealt with as simulated time
+ *   reaches them. The bendulum's motion is worked out analytically: at each CLOSE, the duration of the beat in
+ *   progress is known from the bendulum's nominal tick or tock duration, its random variation, the temperature, the
+ *   effect of the kick just given (or of not having been kicked) and any disturbance, and the next PASS is scheduled. The coil is only
+ *   ever looked at when the library reads it: analogRead() works out what the coil shows at that instant from the
+ *   passes on either side of it and the ring-down of the last kick.
+ *
+ *   Each Arduino function advances simulated time by about what it takes on an Arduino (analogRead() about 112 μs,
+ *   for example). When the coil is sure to read zero for a while -- no pass is near, the last kick has rung down and
+ *   there's no noise -- analogRead() advances time by up to quietStep μs instead; micros() does so whenever no pass
+ *   is near, since the library only reads the clock, not the coil, while it ignores the ringing after a kick. That's
+ *   what lets the library's wait for the next pass run in tens of calls rather than thousands; it costs up to
+ *   quietStep μs in how exactly timeouts and the end of the blanking time are seen, but nothing in how passes are
+ *   timed.
+ *
+ *   The temperature rises and falls by tempSwing about tempMean once a simulated day, and each °C it's above tempMean
+ *   lengthens the beat by tempCoef μs. simThermometer(), passed to the library's setThermometer(), reads it, in
+ *   tenths of a °C, as a thermistor on an analog pin might. The temperature is taken at the pass that starts a beat.
+ *   The beat also lengthens steadily by drift μs a day, as a spring that's relaxing might.
+ *
+ *   The Arduino clock runs fast by the fraction clockErr, and starts at microsStart, so micros() can be made to wrap
+ *   around at a chosen time. Random variations come from a Mersenne Twister seeded with seed, turned into normal
+ *   variates here rather than with the C++ library's distributions, so a run gives the same result everywhere.
+ *
+ *   To use it, fill in a BendulumSimConfig, invoke begin() on the global simulator object, sim, and then run the
+ *   library as a sketch would. After each beat, getPassTime() and getPasses() say what really happened.
+ *
+ ****/
+
+#ifndef BendulumSim_H
+#define BendulumSim_H
+
+#include <queue>
+#include <random>
+#include "Arduino.h"
+
+#define SIMKICKWINDOW	(100000.0)				// Time (μs) after a pass within which a kick counts as following it
+#define SIMREACH		(5)						// Distance (pulse widths) from a pass beyond which its pulse is nil
+
+struct BendulumSimConfig {
+	double tick;							// Nominal duration (μs) of ticks
+	double tock;							// Nominal duration (μs) of tocks
+	double jitter;							// Standard deviation (μs) of the random variation of each beat
+	double amp;								// Height (ADC counts) of the pulse induced by a pass
+	double width;							// Width (μs) of that pulse; its peak is this far from the pass
+	double noise;							// Standard deviation (ADC counts) of the noise in each coil reading
+	double ring;							// Initial height (ADC counts) of the coil's ringing after a kick
+	double ringTau;							// Time constant (μs) of the ringing's decay
+	double ringPeriod;						// Period (μs) of the ringing
+	double kickBest;						// Kick delay (ms) at which a kick changes the beat duration least
+	double kickCoef;						// Increase (μs) in a beat's duration per ms² of kick delay off kickBest
+	double coastExtra;						// Increase (μs) in the duration of a beat that follows no kick
+	double tempMean;						// Average temperature (°C)
+	double tempSwing;						// Amount (°C) the temperature rises and falls each day about tempMean
+	double tempCoef;						// Increase (μs) in the duration of a beat per °C above tempMean
+	double drift;							// Increase (μs) in the duration of a beat per day, as the spring ages
+	double clockErr;						// Fraction by which the Arduino clock runs fast
+	uint32_t microsStart;					// What micros() returns at the start
+	double firstPass;						// Time (μs) of the first pass
+	double quietStep;						// Longest time step (μs) taken while the coil is quiet
+	byte kickPin;							// Pin the library kicks on
+	unsigned long seed;						// Seed for the random variations
+
+	BendulumSimConfig();					// A steady 600/610 ms bendulum on a perfect clock
+};
+
+class BendulumSim {
+private:
+	enum EventType {PASS, CLOSE, DISTURB};
+	struct Event {
+		double time;						// Simulated time (μs) at which it happens
+		EventType type;
+		double value;						// For DISTURB, the amount (μs) it lengthens the beat it falls in
+		boolean operator<(const Event &e) const {
+			return time > e.time;			// The priority queue is a max-heap; the earliest event comes first
+		}
+	};
+
+	BendulumSimConfig cfg;					// The bendulum, coil and clock simulated
+	std::priority_queue<Event> events;		// Events yet to happen
+	std::mt19937 rng;						// Source of the random variations
+	double now;								// Simulated time (μs)
+	double lastPass;						// Time (μs) of the last pass
+	double nextPass;						// Time (μs) of the next pass, once known
+	long passes;							// Number of passes so far
+	double disturbance;						// Sum (μs) of the disturbances not yet applied to a beat
+	double kickStart;						// Time (μs) the kick pin was turned on (< 0 if it's off)
+	double kickEnd;							// Time (μs) the last kick ended
+	bool kicked;							// Whether the beat begun by the last pass has been kicked
+	double kickDelay;						// Kick delay (ms) after the last pass (< 0 if the kick started before it)
+	double quietFrom;						// Time (μs) after the last kick ended from which the ringing is nil
+
+	void schedule(double t, EventType type, double value);
+											// Queue an event to happen at time t (μs)
+	void advance(double dt);				// Advance simulated time by dt μs, dealing with the events on the way
+	void step(double dt, boolean ringing);	// Advance by dt μs, or further, up to quietStep, if the coil is quiet
+	double quietUntil(boolean ringing);		// Time (μs) up to which the coil is sure to read zero
+	double pulse(double t, double pass, long n);
+											// What pass number n, at time pass, induces in the coil at time t
+	double normal();						// A standard normal variate
+
+public:
+	BendulumSim();
+	void begin(const BendulumSimConfig &config);
+											// Start afresh simulating config
+	void disturb(double t, double amount);	// Lengthen the beat in progress at time t (μs) by amount μs
+	double getTime();						// Get the simulated time (μs)
+	double getPassTime();					// Get the time (μs) of the last pass
+	long getPasses();						// Get the number of passes so far
+	double getBeatDuration();				// Get the mean beat duration (μs) the bendulum would have if kicked
+											//   at the best kick delay, at tempMean, at the start
+	double getTemp();						// Get the temperature (°C) now
+
+	// The Arduino functions
+	uint32_t micros();
+	void delay(unsigned long ms);
+	void delayMicroseconds(unsigned int us);
+	int analogRead(uint8_t pin);
+	void digitalWrite(uint8_t pin, uint8_t value);
+};
+
+extern BendulumSim sim;						// The simulator the Arduino functions use
+
+int simThermometer();						// Read the simulated temperature in tenths of a °C
+
+#endif
@@ -0,0 +1,352 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   outputs.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   Checks of the outputs a bendulum's time drives on AVR processors, run against AvrSim's simulated timers (see
+ *   AvrSim.h). Each check feeds an output the beats of a steady 600/610 ms bendulum for MINUTES simulated minutes,
+ *   each one LATEMIN to LATEMAX ms after the pass that ended it, as loop() might get round to it, and checks the
+ *   edges the output makes:
+ *
+ *       pps         BendulumPPS, with the Arduino clock right and bias 0
+ *       ppsbias     BendulumPPS, with the Arduino clock 0.5% fast and bias set to match
+ *       display     BendulumDisplay, 6 digits, told the coil is watched from WATCHLEAD ms before each pass until it
+ *       hands       BendulumHands, 4096 steps an hour at up to 400 a second, the hands a minute behind to start with
+ *
+ *   A BendulumPPS check fails unless there's a pulse for each second of bendulum time, each starting within PPSTOL
+ *   ticks of the start of its second and lasting exactly PPSWIDTH μs, and getMinInterval() and getMaxInterval()
+ *   are within 2 * PPSTOL ticks of a second. A BendulumDisplay check fails unless the digits are lit one at a time,
+ *   each DISPLAYTICK μs after the last, except that none is lit while the coil is watched, and the seconds digit
+ *   shows each second, in turn, from no more than EARLYTOL μs before it starts (or the watch ends, if it starts
+ *   during one) to no more than LATETOL μs after. A BendulumHands check fails unless the hands first catch up,
+ *   taking the steps they're behind exactly a maxRate step apart, and then take a step at the start of each
+ *   stepsPerHour part of the hour, within PPSTOL ticks, each step pulse lasting exactly HANDSWIDTH μs, and end up
+ *   with getLag() 0.
+ *
+ *   This file includes the outputs' headers without BENDULUM_NO_ISR, as a sketch would, so it also checks that a
+ *   sketch gets the interrupt handlers it needs from them (AvrSim stops the run if it doesn't) and that the library's
+ *   own objects leave the handlers out (they wouldn't link if they didn't).
+ *
+ *   Usage: outputs [name ...]   Run the named checks, or all of them. The exit status is the number that failed.
+ *
+ ****/
+
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "BendulumPPS.h"
+#include "BendulumDisplay.h"
+#include "BendulumHands.h"
+
+#define MINUTES		(20)						// Simulated minutes each check runs: short of the half hour or so
+												//   after which the tick count wraps (see AvrSim.h)
+#define TICK		(600000L)					// Durations (μs) of the bendulum's ticks and tocks
+#define TOCK		(610000L)
+#define FIRSTPASS	(123457)					// Time (μs) of the first pass
+#define LATEMIN		(20)						// Range of times (ms) after a pass at which an output is told of it
+#define LATEMAX		(300)
+#define PPSTOL		(16)						// Number of ticks by which a pulse may start off its second
+#define EARLYTOL	(DISPLAYTICK + 4)			// Time (μs) by which a second may be shown early: a refresh,
+												//   and a step of micros()
+#define LATETOL		(7 * DISPLAYTICK)			// Time (μs) by which it may be shown late: a round of the digits
+#define STEPS		(4096)						// Steps per hour and max steps per second of the hands
+#define MAXRATE		(400)
+#define WATCHLEAD	(100)						// Time (ms) before a pass from which the coil is watched, as
+												//   WATCHMARGIN has it when RUNNING
+
+enum Output {PPS, DISPLAY, HANDS};
+
+struct Check {
+	const char *name;
+	Output output;							// The output checked
+	int bias;								// The bias (tenths of a second per day) the clock is corrected by
+};
+
+static const Check checks[] = {
+//	 name			output	bias
+	{"pps",			PPS,	0},
+	{"ppsbias",		PPS,	-4320},
+	{"display",		DISPLAY,	0},
+	{"hands",		HANDS,	0}
+};
+
+static const byte segPins[8] = {2, 3, 4, 5, 6, 7, 8, 13};	// The display's segments a - g and dp
+static const byte digitPins[6] = {A0, A1, A2, A3, 11, 12};	// Its digits, left to right
+static const byte font[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+												// The segments it lights for each decimal digit
+
+static std::mt19937 rng;					// For the times the outputs are told of the passes
+static double perUs;						// Number of cycles per μs of the bendulum's time
+static double pass;							// Time (cycles) of the last pass
+static long passes;							// Number of passes so far
+static std::vector<uint64_t> watchFrom;		// Times (cycles) the coil was watched from and until
+static std::vector<uint64_t> watchTo;
+
+// Start the bendulum afresh, on an Arduino whose clock runs fast by clockErr
+static void startBeats(double clockErr) {
+	avr.begin();
+	rng.seed(42);
+	perUs = CYCLESPERUS * (1 + clockErr);
+	pass = FIRSTPASS * perUs;
+	passes = 0;
+	watchFrom.clear();
+	watchTo.clear();
+}
+
+// Wait for the next pass and then LATEMIN to LATEMAX ms more, and say when the pass was, by the Arduino's clock,
+// and the duration (μs) of the beat it ended, as beat() and getPassTime() would. If there's a watch function, tell
+// it the coil is watched from WATCHLEAD ms before the pass until the pass. Return false once MINUTES are up.
+static boolean nextBeat(long &beatDur, unsigned long &passTime, void (*watch)(boolean watching)) {
+	beatDur = passes == 0 ? 0 : (passes % 2 == 1 ? TICK : TOCK);
+	pass += beatDur * perUs;
+	passes++;
+	if (pass > (FIRSTPASS + MINUTES * 60e6) * perUs) {
+		return false;
+	}
+	if (watch != NULL) {
+		avr.advanceTo((uint64_t)(pass - WATCHLEAD * 1000 * perUs));
+		watchFrom.push_back(avr.getTime());
+		watch(true);
+	}
+	avr.advanceTo((uint64_t)pass);
+	passTime = micros();
+	if (watch != NULL) {
+		watch(false);
+		watchTo.push_back(avr.getTime());
+	}
+	avr.advance((uint64_t)((LATEMIN + rng() % (LATEMAX - LATEMIN + 1)) * 1000 * perUs));
+	return true;
+}
+
+// Run a BendulumPPS check; print and check its results. Return whether it passed.
+static boolean checkPPS(const Check &c) {
+	BendulumPPS pps;
+	long beatDur;
+	unsigned long passTime;
+	long pulses = 0;						// Number of pulses started
+	long seconds;							// Number of seconds of bendulum time that have started
+	double off;								// Time (ticks) by which a pulse started off the start of its second
+	double offMin = 0, offMax = 0;
+	uint64_t rose = 0;						// Time (cycles) the last pulse started
+	boolean widthOk = true;
+	double second;							// Duration (ticks) of a second of bendulum time
+	boolean ok;
+
+	startBeats(-c.bias / (864000.0 + c.bias));
+	pps.begin();
+	while (nextBeat(beatDur, passTime, NULL)) {
+		pps.addBeat(beatDur, passTime, c.bias);
+	}
+	for (size_t i = 0; i < avr.edges.size(); i++) {
+		if (avr.edges[i].pin != PPSPIN) {
+			continue;
+		}
+		if (avr.edges[i].level == HIGH) {
+			pulses++;
+			rose = avr.edges[i].time;
+			off = (rose - (FIRSTPASS + pulses * 1e6) * perUs) / (CYCLESPERUS / TIMERTICKS);
+			offMin = off < offMin ? off : offMin;
+			offMax = off > offMax ? off : offMax;
+		} else {
+			widthOk = widthOk && avr.edges[i].time - rose == PPSWIDTH * CYCLESPERUS;
+		}
+	}
+	seconds = (long)floor((avr.getTime() / perUs - FIRSTPASS) / 1e6);
+	second = 1e6 * perUs / (CYCLESPERUS / TIMERTICKS);
+	ok = pulses == seconds && offMin >= -PPSTOL && offMax <= PPSTOL && widthOk &&
+		fabs(pps.getMinInterval() - second) <= 2 * PPSTOL && fabs(pps.getMaxInterval() - second) <= 2 * PPSTOL;
+	printf("%-12s pulses %5ld (%5ld)  off %4.0f to %3.0f ticks (%d)  width %s  interval %lu to %lu ticks (%.0f)  %s\n",
+		c.name, pulses, seconds, offMin, offMax, PPSTOL, widthOk ? "ok" : "wrong", pps.getMinInterval(),
+		pps.getMaxInterval(), second, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+// Run a BendulumDisplay check; print and check its results. Return whether it passed. The edges are taken in groups
+// made at the same time, and what's lit is looked at after each group.
+static boolean checkDisplay(const Check &c) {
+	BendulumDisplay display;
+	long beatDur;
+	unsigned long passTime;
+	uint64_t start;							// Time (cycles) the time was set
+	byte level[20] = {0};					// The level of each pin
+	int lit;								// The digit lit; -1 if none
+	int litBefore = -1;						// The digit lit before
+	int n;									// Number of digits lit
+	byte seg;								// The segments lit
+	int shown = -1;							// The value the seconds digit last showed
+	uint64_t lastOn = 0;					// Time (cycles) a digit was last lit
+	size_t w = 0;							// Index of the next watch to end
+	long seconds = 0;						// Number of seconds shown
+	long due;								// Number of seconds that should have been
+	double at;								// Time (cycles) from which the next second should be shown
+	double late;							// Time (ms) by which it was shown late
+	double lateMin = 0, lateMax = 0;
+	boolean refreshOk = true, darkOk = true, valueOk = true;
+	boolean ok;
+
+	startBeats(0);
+	display.begin(segPins, digitPins, 6, HIGH, LOW);
+	start = avr.getTime();
+	display.setTime(12, 0, 0);
+	while (nextBeat(beatDur, passTime, BendulumDisplay::watch)) {
+		display.addBeat(beatDur, passTime);
+	}
+	for (size_t i = 0; i < avr.edges.size(); i++) {
+		level[avr.edges[i].pin] = avr.edges[i].level;
+		if (i + 1 < avr.edges.size() && avr.edges[i + 1].time == avr.edges[i].time) {
+			continue;
+		}
+		while (w < watchTo.size() && watchTo[w] <= avr.edges[i].time) {
+			w++;
+		}
+		lit = -1;
+		n = 0;
+		for (int d = 0; d < 6; d++) {
+			if (level[digitPins[d]] == LOW) {
+				lit = d;
+				n++;
+			}
+		}
+		if (n == 0) {
+			litBefore = -1;
+			continue;
+		}
+		darkOk = darkOk && n == 1 && (w >= watchFrom.size() || avr.edges[i].time <= watchFrom[w]);
+		if (lit == litBefore) {
+			continue;
+		}
+		if (lastOn != 0) {					// A digit is lit DISPLAYTICK μs after the last, or a whole number of
+			refreshOk = refreshOk && (avr.edges[i].time - lastOn) % (DISPLAYTICK * CYCLESPERUS) == 0 &&
+				(avr.edges[i].time - lastOn == DISPLAYTICK * CYCLESPERUS || (w > 0 && watchFrom[w - 1] > lastOn));
+		}									//   of them later if there was a watch in between
+		lastOn = avr.edges[i].time;
+		litBefore = lit;
+		if (lit != 5) {
+			continue;
+		}
+		seg = 0;
+		for (int b = 0; b < 7; b++) {
+			seg |= level[segPins[b]] << b;
+		}
+		if (shown >= 0 && seg == font[shown]) {
+			continue;
+		}
+		if (shown >= 0) {
+			seconds++;
+			valueOk = valueOk && seg == font[seconds % 10];
+			at = start + seconds * 1e6 * perUs;
+			for (size_t v = 0; v < watchFrom.size() && watchFrom[v] < at; v++) {
+				at = at < watchTo[v] ? watchTo[v] : at;
+			}
+			late = (avr.edges[i].time - at) / perUs / 1000;
+			lateMin = late < lateMin ? late : lateMin;
+			lateMax = late > lateMax ? late : lateMax;
+		}
+		for (shown = 0; shown < 9 && font[shown] != seg; shown++) {
+		}
+	}
+	due = (long)floor((avr.getTime() - start) / perUs / 1e6 - LATETOL / 1e6);
+	ok = seconds == due && lateMin >= -EARLYTOL / 1000.0 && lateMax <= LATETOL / 1000.0 && refreshOk && darkOk &&
+		valueOk;
+	printf("%-12s seconds %5ld (%5ld)  late %6.3f to %5.3f ms (%.3f to %.3f)  refresh %s  dark %s  values %s  %s\n",
+		c.name, seconds, due, lateMin, lateMax, -EARLYTOL / 1000.0, LATETOL / 1000.0,
+		refreshOk ? "ok" : "wrong", darkOk ? "ok" : "wrong", valueOk ? "ok" : "wrong", ok ? "ok" : "FAILED");
+	return ok;
+}
+
+// Run a BendulumHands check; print and check its results. Return whether it passed.
+static boolean checkHands(const Check &c) {
+	BendulumHands hands;
+	long beatDur;
+	unsigned long passTime;
+	uint64_t start;							// Time (cycles) the time was set
+	long behind;							// Number of steps the hands were behind then
+	long stepsTaken = 0;					// Number of steps taken
+	long due;								// Number that should have been
+	uint64_t rose = 0;						// Time (cycles) the last step started
+	double off;								// Time (ticks) by which a step on time started off its due time
+	double offMin = 0, offMax = 0;
+	boolean catchUpOk = true, widthOk = true;
+	double step;							// Duration (cycles) of a step
+	boolean ok;
+
+	startBeats(0);
+	hands.begin(STEPS, MAXRATE, 8, HIGH);
+	hands.setHands(11, 59, 0);
+	start = avr.getTime();
+	hands.setTime(12, 0, 0);
+	behind = hands.getLag();				// Plus the step it may have started already
+	for (size_t i = 0; i < avr.edges.size(); i++) {
+		behind += avr.edges[i].pin == HANDSPIN && avr.edges[i].level == HIGH ? 1 : 0;
+	}
+	step = 3600e6 / STEPS * perUs;
+	while (nextBeat(beatDur, passTime, NULL)) {
+		hands.addBeat(beatDur, passTime);
+	}
+	for (size_t i = 0; i < avr.edges.size(); i++) {
+		if (avr.edges[i].pin != HANDSPIN) {
+			continue;
+		}
+		if (avr.edges[i].level == LOW) {
+			widthOk = widthOk && avr.edges[i].time - rose == HANDSWIDTH * CYCLESPERUS;
+			continue;
+		}
+		stepsTaken++;
+		if (stepsTaken <= behind) {			// Catching up
+			catchUpOk = catchUpOk && (stepsTaken == 1 || avr.edges[i].time - rose == 1000000L / MAXRATE * CYCLESPERUS);
+		} else {							// On time
+			off = (avr.edges[i].time - (start + (stepsTaken - behind) * step)) / (CYCLESPERUS / TIMERTICKS);
+			offMin = off < offMin ? off : offMin;
+			offMax = off > offMax ? off : offMax;
+		}
+		rose = avr.edges[i].time;
+	}
+	due = behind + (long)floor((avr.getTime() - start) / step);
+	ok = stepsTaken == due && catchUpOk && offMin >= -PPSTOL && offMax <= PPSTOL && widthOk && hands.getLag() == 0;
+	printf("%-12s steps %5ld (%5ld)  caught up %ld %s  off %4.0f to %3.0f ticks (%d)  width %s  lag %ld  %s\n",
+		c.name, stepsTaken, due, behind, catchUpOk ? "ok" : "wrong", offMin, offMax, PPSTOL, widthOk ? "ok" : "wrong",
+		hands.getLag(), ok ? "ok" : "FAILED");
+	return ok;
+}
+
+// Run check c on the output it's for
+static boolean run(const Check &c) {
+	switch (c.output) {
+		case PPS:
+			return checkPPS(c);
+		case DISPLAY:
+			return checkDisplay(c);
+		case HANDS:
+			return checkHands(c);
+	}
+	return false;
+}
+
+// Run each check in a process of its own, so that it starts from reset, the library's static variables and all
+int main(int argc, char **argv) {
+	int failed = 0;
+	int status;								// How the check's process exited
+
+	for (unsigned int i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+		boolean wanted = argc < 2;
+		for (int a = 1; a < argc; a++) {
+			wanted = wanted || strcmp(argv[a], checks[i].name) == 0;
+		}
+		if (!wanted) {
+			continue;
+		}
+		fflush(stdout);
+		if (fork() == 0) {
+			exit(run(checks[i]) ? 0 : 1);
+		}
+		if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			failed++;
+		}
+	}
+	return failed;
+}
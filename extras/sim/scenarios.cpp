@@ -0,0 +1,297 @@
+/****
+ *
+ *   Part of the "Bendulum" library for Arduino. Version 1.23
+ *
+ *   scenarios.cpp Copyright 2013 by D. L. Ehnebuske
+ *   License terms: Creative Commons Attribution-ShareAlike 3.0 United States (CC BY-SA 3.0 US)
+ *                  See http://creativecommons.org/licenses/by-sa/3.0/us/ for specifics.
+ *
+ *   Golden scenarios: runs a Bendulum object against a BendulumSim bendulum from power-on (SETTLING) until it has been
+ *   RUNNING for some simulated days, for each of a set of bendulums, and checks how it did against what it did when
+ *   the scenarios were last blessed. For each scenario, it records
+ *
+ *       run     Time (s) from power-on until RUNNING
+ *       ppm     Error of the beat duration, getBeatDuration(), at the end, in parts per million of the true one
+ *       err     Accumulated time error (s) of a clock adding up what beat() returns while RUNNING, at the end
+ *       kick    Kick delay (ms) in use once RUNNING
+ *
+ *   A scenario fails if run is more than RUNTOL longer than its golden value, if ppm or err is further from zero
+ *   than its golden value by more than PPMTOL or ERRTOL, or if kick isn't its golden value. The thermal scenario also
+ *   fails if the temperature coefficient learned, getTempCoef(), is off the true one by more than COEFTOL of it, and
+ *   the drifting one if the drift rate forecast, getDriftRate(), is. The selfstart and stalled scenarios fail unless
+ *   the Bendulum object went through STARTING, and the commanded one unless its command over the serial line was
+ *   answered with the bias set. In the coasting scenario, the truth ppm is measured against includes the coasted
+ *   beats' extra length, which getBeatDuration() leaves out, so err is what shows how well it's allowed for.
+ *
+ *   Everything is simulated from fixed seeds, so a run gives the same numbers every time; a change that makes them
+ *   worse shows up as a failure, one that makes them better as a chance to bless the new values by editing the table
+ *   below.
+ *
+ *   Usage: scenarios [name ...]   Run the named scenarios, or all of them. The exit status is the number that failed.
+ *
+ ****/
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "Bendulum.h"
+#include "BendulumCommand.h"
+#include "BendulumFit.h"
+#include "BendulumSim.h"
+
+#define RUNTOL		(0.10)						// Fraction by which run may exceed its golden value
+#define PPMTOL		(1.0)						// Amount (ppm) by which |ppm| may exceed its golden value
+#define ERRTOL		(0.1)						// Amount (s) by which |err| may exceed its golden value
+#define COEFTOL		(0.05)						// Fraction by which a learned coefficient may be off the true one
+
+enum Tweak {NONE, FAST, SLOW, NOISY, RESONATOR, DISTURBED, WRAPAROUND, TUNED, ROBUST, KALMAN, WARMING, THERMAL, DRIFTING,
+	LEASTSQ, FITTED, SELFSTART, STALLED, COASTING, COMMANDED};
+
+struct Scenario {
+	const char *name;
+	Tweak tweak;							// How the bendulum differs from BendulumSimConfig's standard one
+	double days;							// Simulated days RUNNING
+	double run;								// Golden values of run (s), ppm, err (s) and kick (ms)
+	double ppm;
+	double err;
+	int kick;
+};
+
+static const Scenario scenarios[] = {
+//	 name			tweak		days	run		ppm		err		kick
+	{"standard",	NONE,		2,		2672,	-1.69,	-0.084,	5},
+	{"fast",		FAST,		2,		1109,	-3.94,	-0.224,	5},
+	{"slow",		SLOW,		1,		5297,	0.11,	0.022,	5},
+	{"noisy",		NOISY,		0.25,	2816,	-2.86,	-0.035,	5},
+	{"resonator",	RESONATOR,	2,		2672,	-0.04,	0.126,	5},
+	{"disturbed",	DISTURBED,	2,		2672,	-1.69,	-0.084,	5},
+	{"wraparound",	WRAPAROUND,	1,		2672,	-1.43,	-0.004,	5},
+	{"tuned",		TUNED,		1,		2752,	-0.72,	0.004,	7},
+	{"robust",		ROBUST,		2,		2672,	-1.69,	-0.016,	5},
+	{"kalman",		KALMAN,		2,		2150,	-0.04,	0.045,	5},
+	{"warming",		WARMING,	1.25,		2672,	-4.02,	-0.552,	5},
+	{"drifting",	DRIFTING,	6,		2672,	-18.44,	-0.301,	5},
+	{"thermal",		THERMAL,	1.25,		2672,	-4.02,	-0.112,	5},
+	{"leastsq",		LEASTSQ,	2,		2043,	-4.99,	-0.551,	5},
+	{"fitted",		FITTED,		2,		352,	-1.65,	-0.018,	5},
+	{"selfstart",	SELFSTART,	1,		2687,	-1.43,	-0.004,	5},
+	{"stalled",		STALLED,	1,		2736,	-1.43,	-0.004,	5},
+	{"coasting",	COASTING,	2,		2672,	-44.08,	0.568,	5},
+	{"commanded",	COMMANDED,	2,		2672,	-0.04,	0.118,	5}
+};
+
+// The serial line the commanded scenario's BendulumCommand object reads: the whole script arrives at once, and
+// what's written is kept
+class ScriptStream : public Stream {
+public:
+	std::string script;						// What has arrived and not been read
+	std::string written;					// What has been written
+
+	int available() {
+		return script.size();
+	}
+	int read() {
+		int c = peek();
+		if (c >= 0) {
+			script.erase(0, 1);
+		}
+		return c;
+	}
+	int peek() {
+		return script.empty() ? -1 : (unsigned char)script[0];
+	}
+	int availableForWrite() {
+		return 64;
+	}
+	size_t write(uint8_t c) {
+		written += (char)c;
+		return 1;
+	}
+};
+
+template <class Estimator>
+static BasicBendulumCommand<Estimator> *command = NULL;	// The command object the idle function polls
+
+// The commanded scenario's idle function, as a sketch would have it
+template <class Estimator>
+static void pollCommand() {
+	command<Estimator>->poll();
+}
+
+// Set up cfg for tweak, and b as a sketch would for it. ROBUST, KALMAN and LEASTSQ are the standard bendulum,
+// calibrated with RobustMean, KalmanFilter and LeastSquares instead of RunningMean (see run()).
+template <class Estimator>
+static void setUp(Tweak tweak, BendulumSimConfig &cfg, BasicBendulum<Estimator> &b) {
+	switch (tweak) {
+		case FAST:							// A short, stiff bendulum
+			cfg.tick = 250000;
+			cfg.tock = 252000;
+			cfg.width = 4000;
+			break;
+		case SLOW:							// A long, floppy one
+			cfg.tick = 1200000;
+			cfg.tock = 1215000;
+			cfg.width = 12000;
+			break;
+		case NOISY:							// A noisy coil
+			cfg.noise = 3;
+			break;
+		case RESONATOR:						// An Arduino clock that's 0.5% fast, with the bias set to match,
+			cfg.clockErr = 0.005;			//   beyond where bias times a beat overflows 32 bits
+			b.setBias(-(int)round(cfg.clockErr / (1 + cfg.clockErr) * 864000));
+			break;
+		case WRAPAROUND:					// micros() wraps around about 25 minutes in, while CALIBRATING
+			cfg.microsStart = UINT32_MAX - 1500000000UL;
+			break;
+		case WARMING:						// A bendulum whose beat is 2 μs longer per °C warmer, with the
+		case THERMAL:						//   temperature rising and falling 5 °C a day, without and with a
+			cfg.tempSwing = 5;				//   thermometer. The thermometer is read early in the blanking
+			cfg.tempCoef = 2;				//   time, which steps of quietStep would skip right over
+			cfg.quietStep = 1000;
+			break;
+		case DRIFTING:						// A bendulum whose beat lengthens by 5 μs a day
+			cfg.drift = 5;
+			break;
+		case TUNED:							// A bendulum whose beat depends on when it's kicked, with TUNING
+			cfg.kickBest = 10;				//   on to find the kick delay that disturbs it least
+			cfg.kickCoef = 20;
+			b.setTgtTune(8);
+			break;
+		case FITTED:						// A steadier bendulum, which the spectral estimator calibrates in
+			cfg.jitter = 10;				//   minutes rather than the better part of an hour
+			break;
+		case SELFSTART:						// A bendulum that's still for its first 10 s, started in STARTING
+			cfg.firstPass = 10e6;
+			b.setRunMode(STARTING);
+			break;
+		case STALLED:						// A bendulum that stops for a while during SCALING, with self-starting
+			b.setAutoStart(true);			//   on to get it going again (see runScenario())
+			break;
+		case COASTING:						// A bendulum whose beat is 40 μs longer without a kick, kicked only
+			cfg.coastExtra = 40;			//   every third beat when RUNNING
+			b.setKickEvery(3);
+			break;
+		case COMMANDED:						// The resonator's clock, with the bias set over the serial line
+			cfg.clockErr = 0.005;			//   rather than by the sketch. The commands are polled while the coil
+			cfg.quietStep = 1000;			//   is ignored, which steps of quietStep would skip right over
+			break;
+		default:
+			break;
+	}
+}
+
+// Run scenario s with a BasicBendulum<Estimator>; print and check its results. Return whether it passed.
+template <class Estimator>
+static boolean runScenario(const Scenario &s) {
+	BendulumSimConfig cfg;
+	BasicBendulum<Estimator> b;
+	int mode = SETTLING;
+	double run;								// Time (s) from power-on until RUNNING
+	double start;							// Time (μs) of the pass RUNNING started at
+	long startPasses;						// Number of passes then
+	double sum = 0;							// Sum (μs) of what beat() returned since
+	double truth;							// True mean beat duration (μs) since
+	double ppm, err;
+	int kick;								// Kick delay (ms) in use once RUNNING
+	double coef;							// True temperature coefficient (μs per cycle per reading) or drift
+											//   rate (μs per cycle per DRIFTBLOCK cycles)
+	boolean started = false;				// Whether it was ever STARTING
+	BendulumFit fit;
+	ScriptStream serial;
+	BasicBendulumCommand<Estimator> cmd(b, serial);
+	char bias[16];							// The bias command, and its answer
+	boolean ok;
+
+	setUp(s.tweak, cfg, b);
+	sim.begin(cfg);
+	if (s.tweak == THERMAL) {				// The thermometer is read as soon as it's set, so set it once the
+		b.setThermometer(simThermometer);	//   simulation has begun
+	}
+	if (s.tweak == FITTED) {
+		b.setFit(&fit);
+	}
+	if (s.tweak == COMMANDED) {
+		snprintf(bias, sizeof(bias), "b %d", -(int)round(cfg.clockErr / (1 + cfg.clockErr) * 864000));
+		serial.script = std::string(bias) + "\n";
+		command<Estimator> = &cmd;
+		b.setIdle(pollCommand<Estimator>);
+	}
+	while (b.getRunMode() != RUNNING) {
+		started = started || b.getRunMode() == STARTING;
+		b.beat();
+		if (b.getRunMode() != mode) {
+			mode = b.getRunMode();
+			if (mode == CALIBRATING && s.tweak == DISTURBED) {
+				sim.disturb(sim.getTime() + 600e6, 20000);
+			}								// Someone bumps it ten minutes into CALIBRATING
+			if (mode == SCALING && s.tweak == STALLED && !started) {
+				sim.disturb(sim.getTime(), 20e6);
+			}								// It stops for 20 s, longer than STALLTIME, as SCALING first starts
+		}
+	}
+	run = sim.getTime() / 1e6;
+	kick = b.getKickDelay();
+	start = sim.getPassTime();
+	startPasses = sim.getPasses();
+	while (sim.getTime() < start + s.days * 86400e6) {
+		sum += b.beat();
+	}
+	truth = (sim.getPassTime() - start) / (sim.getPasses() - startPasses);
+	ppm = (b.getBeatDuration() / truth - 1) * 1e6;
+	err = (sum - (sim.getPassTime() - start)) / 1e6;
+	ok = run <= s.run * (1 + RUNTOL) && fabs(ppm) <= fabs(s.ppm) + PPMTOL && fabs(err) <= fabs(s.err) + ERRTOL &&
+		kick == s.kick;
+	printf("%-12s run %7.0f s (%7.0f)  ppm %7.2f (%7.2f)  err %7.3f s (%7.3f)  kick %2d ms (%2d) after %g days  %s\n",
+		s.name, run, s.run, ppm, s.ppm, err, s.err, kick, s.kick, s.days, ok ? "ok" : "FAILED");
+	if (s.tweak == THERMAL) {				// A cycle is two beats, and the thermometer reads tenths of a °C
+		coef = 2 * cfg.tempCoef / 10;
+		ok = ok && fabs(b.getTempCoef() - coef) <= COEFTOL * coef;
+		printf("%-12s tempCoef %.3f (%.3f)  %s\n", s.name, b.getTempCoef(), coef,
+			fabs(b.getTempCoef() - coef) <= COEFTOL * coef ? "ok" : "FAILED");
+	}
+	if (s.tweak == DRIFTING) {				// A cycle is two beats, and there are 86400e6 / truth / 2 of them a day
+		coef = 2 * cfg.drift * DRIFTBLOCK * 2 * truth / 86400e6;
+		ok = ok && fabs(b.getDriftRate() - coef) <= COEFTOL * coef;
+		printf("%-12s driftRate %.3f (%.3f)  %s\n", s.name, b.getDriftRate(), coef,
+			fabs(b.getDriftRate() - coef) <= COEFTOL * coef ? "ok" : "FAILED");
+	}
+	if (s.tweak == SELFSTART || s.tweak == STALLED) {
+		ok = ok && started;
+		printf("%-12s STARTING %s  %s\n", s.name, started ? "yes" : "no", started ? "ok" : "FAILED");
+	}
+	if (s.tweak == COMMANDED) {				// The command is answered with what it set
+		ok = ok && serial.written == std::string(bias) + "\r\n";
+		printf("%-12s answer \"%.*s\" (\"%s\")  %s\n", s.name, (int)serial.written.find_first_of("\r\n"),
+			serial.written.c_str(), bias, serial.written == std::string(bias) + "\r\n" ? "ok" : "FAILED");
+	}
+	return ok;
+}
+
+// Run scenario s with the estimator it calls for
+static boolean run(const Scenario &s) {
+	switch (s.tweak) {
+		case ROBUST:
+			return runScenario<RobustMean>(s);
+		case KALMAN:
+			return runScenario<KalmanFilter>(s);
+		case LEASTSQ:
+			return runScenario<LeastSquares>(s);
+		default:
+			return runScenario<RunningMean>(s);
+	}
+}
+
+int main(int argc, char **argv) {
+	int failed = 0;
+
+	for (unsigned int i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		boolean wanted = argc < 2;
+		for (int a = 1; a < argc; a++) {
+			wanted = wanted || strcmp(argv[a], scenarios[i].name) == 0;
+		}
+		if (wanted && !run(scenarios[i])) {
+			failed++;
+		}
+	}
+	return failed;
+}